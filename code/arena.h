@@ -0,0 +1,178 @@
+#ifndef INCLUDE_ARENA_H
+#define INCLUDE_ARENA_H
+
+/* Allocator for the large arrays (vectors of `linear_algebra`, grids of `laplace`).
+ *
+ * Compared to `malloc()`, the blocks are
+ * - aligned on `ARENA_ALIGNMENT` bytes (a cache line, and the size of an AVX-512 register), so that no SIMD load is split between two cache lines,
+ * - backed by 2 MiB (huge) pages when they are large enough, which needs 512 times less TLB entries than 4 KiB pages,
+ * - kept when they are freed, so that the next allocation of the same size reuses them (without asking the system for new pages, which then have to be zeroed and faulted in again),
+ * - shifted by a different number of cache lines ("colors"): otherwise, all the large blocks would start on a 2 MiB boundary, and the same element of two arrays (e.g., the two grids of jacobi) would compete for the same cache sets, which made jacobi twice slower.
+ *
+ * The allocator is selected with `arena_select()`, so that the difference can be measured:
+ * - `malloc`: plain `malloc()` and `free()`,
+ * - `aligned`: `aligned_alloc()`, with reuse,
+ * - `thp` (default): transparent huge pages (`madvise(MADV_HUGEPAGE)` on a mapping aligned on 2 MiB), with reuse,
+ * - `huge`: explicit huge pages (`MAP_HUGETLB`, which requires pages reserved in `/proc/sys/vm/nr_hugepages`), with reuse. If there are not enough of them, transparent huge pages are used instead.
+ *
+ * The memory is not touched by `arena_alloc()` (unless a block is reused), so that it is placed by the first thread that writes it, as with `malloc()`.
+ * The functions are not thread safe: they should be called outside of the parallel regions.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/mman.h>
+
+#define ARENA_ALIGNMENT 64
+#define ARENA_HUGE_PAGE (2 << 20)
+#define ARENA_BLOCKS 64 // maximal number of blocks (used or kept for reuse)
+#define ARENA_COLOR (17 * ARENA_ALIGNMENT) // shift between two consecutive blocks (an odd number of cache lines, thus never a multiple of the 4 KiB pages)
+#define ARENA_COLORS 8
+
+/* Allocators (`-a xx`), the names are given in the same order in `ARENAS` */
+enum {
+    ARENA_MALLOC,
+    ARENA_ALIGNED,
+    ARENA_THP,
+    ARENA_HUGE
+};
+
+const char* ARENAS[] = {"malloc", "aligned", "thp", "huge", NULL};
+
+typedef struct ArenaBlock_ {
+    void* pointer;
+    void* base; // (`pointer`, without the color)
+    size_t size; // (rounded up, including the color)
+    int kind; // how it was obtained (`ARENA_ALIGNED`, `ARENA_THP` or `ARENA_HUGE`)
+    int used;
+} ArenaBlock;
+
+/* selected allocator, and blocks */
+int arena_kind = ARENA_THP;
+ArenaBlock arena_blocks[ARENA_BLOCKS];
+int arena_nblocks = 0;
+int arena_ncolors = 0; // number of colors used so far
+
+/* Select the allocator `name` (NULL for the default).
+ * Returns the name of the allocator, or NULL if it does not exist.
+ */
+const char* arena_select(const char* name) {
+    for(int i=0; ARENAS[i] != NULL; i++) {
+        if((name == NULL && i == ARENA_THP) || (name != NULL && strcmp(ARENAS[i], name) == 0)) {
+            arena_kind = i;
+            return ARENAS[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* Give back block `i` to the system (and remove it from the list).
+ */
+void arena_unmap(int i) {
+    if(arena_blocks[i].kind == ARENA_ALIGNED)
+        free(arena_blocks[i].base);
+    else
+        munmap(arena_blocks[i].base, arena_blocks[i].size);
+
+    arena_blocks[i] = arena_blocks[--arena_nblocks];
+}
+
+/* Map `size` bytes (a multiple of `ARENA_HUGE_PAGE`) on huge pages: explicit ones if `kind` is `ARENA_HUGE` and there are enough of them, transparent ones otherwise.
+ * Returns NULL on error.
+ */
+void* arena_map(size_t size, int* kind) {
+    if(*kind == ARENA_HUGE) {
+        void* pointer = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if(pointer != MAP_FAILED)
+            return pointer;
+
+        *kind = ARENA_THP;
+    }
+
+    /* map one more huge page, then cut what is before and after the first huge page boundary */
+    char* map = mmap(NULL, size + ARENA_HUGE_PAGE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if(map == MAP_FAILED)
+        return NULL;
+
+    char* pointer = (char*) (((uintptr_t) map + ARENA_HUGE_PAGE - 1) / ARENA_HUGE_PAGE * ARENA_HUGE_PAGE);
+    if(pointer > map)
+        munmap(map, pointer - map);
+    munmap(pointer + size, map + ARENA_HUGE_PAGE - pointer);
+
+    madvise(pointer, size, MADV_HUGEPAGE);
+    return pointer;
+}
+
+/* Allocate `size` bytes, aligned on (at least) `ARENA_ALIGNMENT` bytes, with the selected allocator.
+ * The content is undefined (a reused block contains what it contained).
+ * Returns NULL on error.
+ */
+void* arena_alloc(size_t size) {
+    if(arena_kind == ARENA_MALLOC)
+        return malloc(size);
+
+    int kind = (arena_kind == ARENA_ALIGNED || size < ARENA_HUGE_PAGE) ? ARENA_ALIGNED : arena_kind;
+    size_t alignment = (kind == ARENA_ALIGNED) ? ARENA_ALIGNMENT : ARENA_HUGE_PAGE;
+    size_t color = (arena_ncolors % ARENA_COLORS) * ARENA_COLOR;
+
+    /* reuse the smallest free block that is large enough */
+    int best = -1;
+    for(int i=0; i < arena_nblocks; i++) {
+        size_t available = arena_blocks[i].size - ((char*) arena_blocks[i].pointer - (char*) arena_blocks[i].base);
+        if(!arena_blocks[i].used && available >= size && (best < 0 || arena_blocks[i].size < arena_blocks[best].size))
+            best = i;
+    }
+
+    if(best >= 0) {
+        arena_blocks[best].used = 1;
+        return arena_blocks[best].pointer;
+    }
+
+    /* otherwise, the free blocks are too small to be of any use: give them back before asking for more memory */
+    for(int i=arena_nblocks - 1; i >= 0; i--) {
+        if(!arena_blocks[i].used)
+            arena_unmap(i);
+    }
+
+    if(arena_nblocks == ARENA_BLOCKS)
+        return NULL;
+
+    size = (size + color + alignment - 1) / alignment * alignment;
+    char* base = (kind == ARENA_ALIGNED) ? aligned_alloc(ARENA_ALIGNMENT, size) : arena_map(size, &kind);
+    if(base == NULL)
+        return NULL;
+
+    arena_ncolors++;
+    arena_blocks[arena_nblocks++] = (ArenaBlock) {.pointer = base + color, .base = base, .size = size, .kind = kind, .used = 1};
+    return base + color;
+}
+
+/* Free a block obtained with `arena_alloc()` (it is kept for the next allocations, see `arena_release()`).
+ */
+void arena_free(void* pointer) {
+    if(pointer == NULL)
+        return;
+
+    for(int i=0; i < arena_nblocks; i++) {
+        if(arena_blocks[i].pointer == pointer) {
+            arena_blocks[i].used = 0;
+            return;
+        }
+    }
+
+    free(pointer); // (from `malloc()`, if the allocator was changed in the meantime)
+}
+
+/* Give back all the free blocks to the system.
+ */
+void arena_release() {
+    for(int i=arena_nblocks - 1; i >= 0; i--) {
+        if(!arena_blocks[i].used)
+            arena_unmap(i);
+    }
+}
+
+#endif // INCLUDE_ARENA_H
@@ -12,6 +12,7 @@
 
 /* Compute the Laplace equation until the maximal change is lower than `threshold` or the number of iteration exceed `max_iter`.
  * The first and last row/column are used to get the values for the Dirichlet (i.e., fixed value) boundary conditions.
+ * The new values and the change are computed in a single pass, then the two buffers are swapped.
  * U: function
  * max_iter: maximal number of iteration
  * threshold: minimal change
@@ -19,9 +20,13 @@
 int laplace(FLT* U, unsigned int width, FLT dx, unsigned int height, FLT dy, int max_iter, FLT threshold) {
     if(U != NULL) {
         
+        FLT* values = U;
         FLT* tmp = malloc(width * height * sizeof(FLT));
         if(tmp == NULL)
             return -1;
+
+        /* both buffers hold the boundary conditions */
+        memcpy(tmp, U, width * height * sizeof(FLT));
         
         FLT error = .0f;
 
@@ -31,16 +36,15 @@ int laplace(FLT* U, unsigned int width, FLT dx, unsigned int height, FLT dy, int
             for(int y=1; y < (height - 1); y++) {
                 for(int x=1; x < (width - 1); x++) {
                     T(x, y) = (dy * dy * ( G(x+1, y) + G(x-1, y) ) +  dx * dx * ( G(x, y+1) + G(x, y-1) )) / (2 * dx * dx + 2 * dy * dy);
-                }
-            }
-
-            for(int y=1; y < (height - 1); y++) {
-                for(int x=1; x < (width - 1); x++) {
                     error = fmax(error, fabs(G(x,y) - T(x,y)));
-                    G(x,y) = T(x,y);
                 }
             }
 
+            /* the new values become the current ones */
+            FLT* swap = U;
+            U = tmp;
+            tmp = swap;
+
             if (error < threshold) {
                 break;
             }
@@ -48,6 +52,12 @@ int laplace(FLT* U, unsigned int width, FLT dx, unsigned int height, FLT dy, int
         
         printf("final error=%f\n", error);
 
+        /* the result must end up in the caller's buffer */
+        if(U != values) {
+            memcpy(values, U, width * height * sizeof(FLT));
+            tmp = U;
+        }
+
         free(tmp);
         return 0;
     }
@@ -86,8 +96,12 @@ int main(int argc, char* argv[]) {
     fclose(input);
 
     /* allocate */
-    width = in->width;
-    height = in->width;
+    if(get_grid_size(argc, argv, in, &width, &height) != 0) {
+        printf("error while reading the size of the grid (-W and -H)\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("using a grid of %dx%d\n", width, height);
 
     FLT* values = malloc(width * height * sizeof(FLT));
     if (values == NULL) {
@@ -102,12 +116,7 @@ int main(int argc, char* argv[]) {
         }
     }
 
-    for (int j=0; j < width; j++)  {
-        values[0 * width + j] = (FLT) (in->pixels[3*(TOP * in->width + j) + 0] - in->pixels[3* (TOP * in->width + j) + 2]) / 255;
-        values[(height-1) * width + j] = (FLT) (in->pixels[3*(BOTTOM * in->width + j) + 0] - in->pixels[3* (BOTTOM * in->width + j) + 2]) / 255;
-        values[j * width + 0] = (FLT) (in->pixels[3*(LEFT * in->width + j) + 0] - in->pixels[3* (LEFT* in->width + j) + 2]) / 255;
-        values[j * width + (width-1)] = (FLT) (in->pixels[3*(RIGHT * in->width + j) + 0] - in->pixels[3* (RIGHT * in->width + j) + 2]) / 255;
-    }
+    fill_boundaries(in, values, width, height);
 
     image_delete(in);
 
@@ -122,42 +131,10 @@ int main(int argc, char* argv[]) {
     
     /* save output */
     if (output_path != NULL) {
-
-        /* find output range */
-        FLT max_positive = .0f, min_negative = .0f;
-        for(int i=0; i < height; i++) {
-            for(int j=0; j < width; j++) {
-                FLT val = values[i * width + j];
-                if (val < .0f)
-                    min_negative = fmin(min_negative, val);
-                else
-                    max_positive = fmax(max_positive, val);
-            }
-        }
-
-        printf("min_negative = %.3f, max_positive = %.3f\n", min_negative, max_positive);
-
-        Image* im = image_new(width, height);
-        for(int i=0; i < height; i++) {
-            for(int j=0; j < width; j++) {
-                FLT val = values[i * width + j];
-                if (val < .0f)
-                    im->pixels[3*(i * width + j) + 2] = (unsigned char) (val / min_negative * 255);
-                else
-                    im->pixels[3*(i * width + j) + 0] = (unsigned char) (val / max_positive * 255);
-            }
-        }
-
-        FILE* output = fopen(output_path, "w");
-        if (output == NULL) {
-            printf("error while opening output image\n");
+        if(write_output(values, width, height, output_path) != 0) {
+            printf("error while writing output image\n");
             return EXIT_FAILURE;
         }
-
-        image_write(im, output);
-        fclose(output);
-
-        image_delete(im);
     }
 
     free(values);
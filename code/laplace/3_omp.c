@@ -1,69 +1,164 @@
 /* OMP version of the 4-point jacobi stencil to solve the Laplace equation.
  * Compile it with `gcc -o laplace.omp 3_omp.c image_ppm.c -lm -O1 -fopenmp`.
- * Run it with `OMP_NUM_THREADS=4 ./laplace.omp -i example_input.ppm`
+ * Run it with `OMP_NUM_THREADS=4 ./laplace.omp -i example_input.ppm`, and add
+ * - `-b 8` to perform 8 iterations per tile while it is in cache,
+ * - `-m sor` to use red-black SOR, `-m mg` to use multigrid, `-m dst` to use the direct solver, or `-m cg` to use the conjugate gradient,
+ * - `-w 1.9` to set the relaxation factor of SOR,
+ * - `-P` to use the jacobi preconditioner with the conjugate gradient,
+ * - `-p single` to compute in single precision, or `-p mixed` to use mixed-precision iterative refinement,
+ * - `-C checkpoint.bin -k 1000` to save a checkpoint every 1000 iterations,
+ * - `-r checkpoint.bin` to restart from it,
+ * - `-O field.bin` to get the values in a binary file,
+ * - `-T telemetry.csv -e 10` to record the convergence every 10 iterations,
+ * - `-g coons`, `-g coarse` or `-g field.bin` to start from an initial guess,
+ * - `-Z` to compare the initial guess with the iterations from zero,
+ * - `-f source.ppm` or `-f source.bin` to solve the Poisson equation with that source term,
+ * - `-E l2` or `-E relative` to change the norm of the convergence check,
+ * - `-c 10` to only check the convergence every 10 iterations (see `convergence.h`),
+ * - `-S avx2` to force the instruction set of the jacobi kernel,
+ * - `-n interleave` or `-n bind` to change the NUMA placement of the grids,
+ * - `-B manifest.txt` to solve all the `input output` pairs listed in `manifest.txt` in a single run,
+ * - `-M` to solve the jobs of `-B` 8 at a time, with jacobi,
+ * - `-a malloc` to allocate the grids without the arena (see `../arena.h`),
+ * - `-A` to pin the threads.
+ * (see the README for the details)
  */
 
 #include "image_ppm.h"
 #include "common.h"
+#include "laplace.h"
+#include "guess.h"
+#include "multi.h"
+#include "batch.h"
 #include <math.h>
 
-#define G(x,y) (U[(y) * width + (x)])
-#define T(x,y) (tmp[(y) * width + (x)])
-
-/* Compute the Laplace equation until the maximal change is lower than `threshold` or the number of iteration exceed `max_iter`.
- * The first and last row/column are used to get the values for the Dirichlet (i.e., fixed value) boundary conditions.
- * U: function
- * max_iter: maximal number of iteration
- * threshold: minimal change
+/* Solve the jobs of the manifest at `path` (see `batch.h`), with the options of the command line (the size of each grid is given by `-W` and `-H`, or by its input image).
+ * If `multi` is set, the jobs are solved `MULTI_LANES` at a time (see `multi.h`), on the grid size of the first one.
+ * If `omega` is 0, the optimal relaxation factor of each grid is used for SOR.
+ * Returns the number of jobs that failed, or -1 if the manifest cannot be read.
  */
-int laplace(FLT* U, unsigned int width, FLT dx, unsigned int height, FLT dy, int max_iter, FLT threshold) {
-    if(U != NULL) {
-        
-        FLT* tmp = malloc(width * height * sizeof(FLT));
-        if(tmp == NULL)
-            return -1;
-        
-        FLT error = .0f;
-
-        for(int iter=0; iter < max_iter; iter++) {
-            error = .0f;
-
-            #pragma omp parallel 
-            {
-                #pragma omp for nowait
-                for(int y=1; y < (height - 1); y++) {
-                    for(int x=1; x < (width - 1); x++) {
-                        T(x, y) = (dy * dy * ( G(x+1, y) + G(x-1, y) ) +  dx * dx * ( G(x, y+1) + G(x, y-1) )) / (2 * dx * dx + 2 * dy * dy);
-                    }
-                }
-
-                #pragma omp for reduction(max:error) 
-                for(int y=1; y < (height - 1); y++) {
-                    for(int x=1; x < (width - 1); x++) {
-                        error = ffmax(error, fabs(G(x,y) - T(x,y)));
-                        G(x,y) = T(x,y);
-                    }
-                }
+int batch(const char* path, int argc, char* argv[], int niter, FLT threshold, int solver, int precision, int depth, FLT omega, int precondition, int multi) {
+    int njobs;
+    BatchJob* jobs = batch_load(path, &njobs);
+    if(jobs == NULL) {
+        if(njobs > 0)
+            printf("error on line %d of the manifest %s, which should be `input output` or `-i input -o output`\n", njobs, path);
+        else
+            printf("error while reading the manifest %s\n", path);
+        return -1;
+    }
+
+    int size = multi ? MULTI_CHUNK : 1, nchunks = (njobs + size - 1) / size;
+    BatchChunk* chunks = malloc((nchunks + 1) * sizeof(BatchChunk));
+    if(chunks == NULL)
+        return -1;
+
+    for(int c=0; c < nchunks; c++)
+        chunks[c] = (BatchChunk) {.jobs = &jobs[c * size], .njobs = (int) fmin(size, njobs - c * size)};
+
+    pthread_t reader, writer;
+    int reading = 0, writing = 0, failed = 0;
+    unsigned int width = 0, height = 0; // (of all the grids, with `multi`)
+    BatchChunk* written = NULL; // (chunk being written)
+    double compute = .0, stalled = .0;
+    struct timespec timer, step;
+
+    timer_start(&timer);
+    if(nchunks > 0)
+        reading = batch_start(&reader, batch_read, &chunks[0]);
+
+    for(int c=0; c < nchunks; c++) {
+        BatchChunk* chunk = &chunks[c];
+
+        /* wait for the inputs of this chunk, then start reading the next one */
+        timer_start(&step);
+        if(reading)
+            pthread_join(reader, NULL);
+        stalled += timer_stop(&step);
+        reading = (c + 1 < nchunks) ? batch_start(&reader, batch_read, &chunks[c + 1]) : 0;
+
+        /* set up the grids */
+        timer_start(&step);
+        FLT* problems[MULTI_CHUNK];
+        int indices[MULTI_CHUNK], iterations[MULTI_CHUNK], n = 0;
+
+        for(int i=0; i < chunk->njobs; i++) {
+            BatchJob* job = &chunk->jobs[i];
+            job->values = NULL;
+
+            if(job->image != NULL && (!multi || width == 0) && get_grid_size(argc, argv, job->image, &width, &height) != 0)
+                width = height = 0;
+
+            if(job->image == NULL || width == 0 || (job->values = grid_alloc(width, height, sizeof(FLT))) == NULL) {
+                printf("job %d/%d: error while reading %s\n", c * size + i + 1, njobs, job->input);
+                if(job->image != NULL)
+                    image_delete(job->image);
+                failed++;
+                continue;
             }
 
-            if (error < threshold) {
-                break;
+            job->width = width;
+            job->height = height;
+            fill_boundaries(job->image, job->values, width, height);
+            image_delete(job->image);
+
+            problems[n] = job->values;
+            indices[n++] = i;
+        }
+
+        /* compute */
+        int sweeps = 0;
+        if(multi && n > 0)
+            sweeps = laplace_multi(problems, n, width, .1, height, .1, niter, threshold, iterations);
+
+        for(int j=0; j < n; j++) {
+            BatchJob* job = &chunk->jobs[indices[j]];
+            if(!multi) {
+                FLT job_omega = (solver == SOR && omega == 0) ? sor_omega_double(job->width, .1, job->height, .1) : omega;
+                iterations[j] = solve(job->values, NULL, job->width, job->height, niter, threshold, solver, precision, depth, job_omega, precondition, NULL, NULL, NULL);
             }
+
+            if(iterations[j] < 0 || sweeps < 0) {
+                printf("job %d/%d: error while executing laplace()\n", c * size + indices[j] + 1, njobs);
+                grid_free(job->values);
+                job->values = NULL;
+                failed++;
+            } else
+                printf("job %d/%d: %s -> %s (%dx%d), %d iterations\n", c * size + indices[j] + 1, njobs, job->input, job->output, job->width, job->height, iterations[j]);
         }
-        
-        printf("final error=%f\n", error);
 
-        free(tmp);
-        return 0;
+        double time = timer_stop(&step);
+        compute += time;
+        if(multi)
+            printf("%d jobs in %d sweeps of %d lanes, in %.3f secs\n", n, sweeps, MULTI_LANES, time);
+
+        /* wait for the outputs of the previous chunk (so that its grids can be reused), then start writing this one */
+        timer_start(&step);
+        if(written != NULL)
+            failed += batch_finish(&writer, writing, written);
+        stalled += timer_stop(&step);
+
+        written = chunk;
+        writing = batch_start(&writer, batch_write, chunk);
     }
+
+    if(written != NULL)
+        failed += batch_finish(&writer, writing, written);
+
+    double total = timer_stop(&timer);
+    printf("batch: %d jobs (%d failed) in %.3f secs, %.3f secs computing (%.1f%%), %.3f secs waiting for I/O\n", njobs, failed, total, compute, (total > 0) ? 100 * compute / total : .0, stalled);
+
+    free(chunks);
+    batch_delete(jobs, njobs);
+    return failed;
 }
 
 int main(int argc, char* argv[]) {
     unsigned int niter, width, height;
-    FLT threshold;
-    char *input_path, *output_path;
-
-    printf("using sizeof(FLT)=%d\n", sizeof(FLT));
+    int depth, solver, precision, period, guess, done = 0;
+    FLT threshold, omega = .0f;
+    char *input_path, *output_path, *depth_option, *solver_option, *omega_option, *isa_option, *precision_option, *placement_option, *arena_option;
+    char *checkpoint_path, *period_option, *restart_path, *raw_path, *guess_option, *telemetry_path, *telemetry_option, *batch_path, *source_path, *norm_option, *check_option;
 
     /* fetch inputs */
     if(get_arguments(argc, argv, &niter, &threshold, &input_path, &output_path) != 0) {
@@ -71,6 +166,146 @@ int main(int argc, char* argv[]) {
         return EXIT_FAILURE;
     }
 
+    if(get_option(argc, argv, "-b", &depth_option, "1") != 0 || (depth = atoi(depth_option)) < 1) {
+        printf("error while reading the number of iterations per block (-b)\n");
+        return EXIT_FAILURE;
+    }
+
+    if(get_option(argc, argv, "-m", &solver_option, "jacobi") != 0 || (solver = get_solver(solver_option)) < 0) {
+        printf("error while reading the solver (-m)\n");
+        return EXIT_FAILURE;
+    }
+
+    if(get_option(argc, argv, "-w", &omega_option, NULL) != 0 || (omega_option != NULL && ((omega = atof(omega_option)) <= 0 || omega >= 2))) {
+        printf("error while reading the relaxation factor (-w), which should be between 0 and 2\n");
+        return EXIT_FAILURE;
+    }
+
+    if(get_option(argc, argv, "-p", &precision_option, (sizeof(FLT) == sizeof(float)) ? "single" : "double") != 0 || (precision = get_choice(PRECISIONS, precision_option)) < 0) {
+        printf("error while reading the precision (-p), which should be single, double or mixed\n");
+        return EXIT_FAILURE;
+    }
+
+    if((solver != JACOBI && solver != SOR && (precision == MIXED || (precision == SINGLE) != (sizeof(FLT) == sizeof(float)))) || (solver == SOR && precision == MIXED)) {
+        printf("the %s solver is not available in %s precision\n", solver_option, precision_option);
+        return EXIT_FAILURE;
+    }
+
+    if(get_option(argc, argv, "-C", &checkpoint_path, NULL) != 0 || get_option(argc, argv, "-r", &restart_path, NULL) != 0) {
+        printf("error while reading the checkpoint (-C) or restart (-r) file\n");
+        return EXIT_FAILURE;
+    }
+
+    if(get_option(argc, argv, "-O", &raw_path, NULL) != 0) {
+        printf("error while reading the raw output (-O)\n");
+        return EXIT_FAILURE;
+    }
+
+    if(get_option(argc, argv, "-g", &guess_option, "zero") != 0 || (restart_path != NULL && strcmp(guess_option, "zero") != 0)) {
+        printf("error while reading the initial guess (-g), which cannot be combined with a restart (-r)\n");
+        return EXIT_FAILURE;
+    }
+
+    guess = get_choice(GUESSES, guess_option);
+    if(guess < 0)
+        guess = GUESS_FILE;
+
+    if(get_option(argc, argv, "-f", &source_path, NULL) != 0 || (source_path != NULL && solver != JACOBI && solver != SOR)) {
+        printf("error while reading the source term (-f), which is only available for the jacobi and sor solvers\n");
+        return EXIT_FAILURE;
+    }
+
+    if(get_option(argc, argv, "-k", &period_option, "1000") != 0 || (period = atoi(period_option)) < 1) {
+        printf("error while reading the number of iterations between checkpoints (-k)\n");
+        return EXIT_FAILURE;
+    }
+
+    if(get_option(argc, argv, "-T", &telemetry_path, NULL) != 0 || get_option(argc, argv, "-e", &telemetry_option, "1") != 0 || atoi(telemetry_option) < 1) {
+        printf("error while reading the telemetry file (-T) or the number of iterations between records (-e)\n");
+        return EXIT_FAILURE;
+    }
+
+    if((checkpoint_path != NULL || telemetry_path != NULL) && solver != JACOBI && solver != SOR) {
+        printf("checkpoints (-C) and telemetry (-T) are only available for the jacobi and sor solvers\n");
+        return EXIT_FAILURE;
+    }
+
+    int norm;
+    if(get_option(argc, argv, "-E", &norm_option, NULL) != 0 || get_option(argc, argv, "-c", &check_option, NULL) != 0 || (norm = get_choice(NORMS, (norm_option != NULL) ? norm_option : "max")) < 0 || (check_option != NULL && atoi(check_option) < 1)) {
+        printf("error while reading the norm of the convergence check (-E), which should be max, l2 or relative, or the number of iterations between checks (-c)\n");
+        return EXIT_FAILURE;
+    }
+
+    if((norm_option != NULL || check_option != NULL) && ((solver != JACOBI && solver != SOR) || precision == MIXED || (solver == JACOBI && depth > 1))) {
+        printf("the convergence checks (-E and -c) are only available for the jacobi (without -b) and sor solvers, in single or double precision\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("using %s precision\n", precision_option);
+
+    /* far from the boundaries, the values start by decaying exponentially, and would spend a long time as (very slow) subnormal numbers in single precision.
+     * Thus, they are flushed to zero (before the threads are created, so that they inherit that mode), on x86 (elsewhere, the mode of the FPU is left as is).
+     */
+#if defined(__x86_64__) || defined(__i386__)
+    if(precision != DOUBLE) {
+        _MM_SET_FLUSH_ZERO_MODE(_MM_FLUSH_ZERO_ON);
+        _MM_SET_DENORMALS_ZERO_MODE(_MM_DENORMALS_ZERO_ON);
+    }
+#endif
+
+    if(get_option(argc, argv, "-S", &isa_option, NULL) != 0 || (isa_option = (char*) simd_select(isa_option)) == NULL) {
+        printf("error while selecting the instruction set (-S), which should be scalar, sse2, avx2 or avx512 (and supported by the CPU)\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("using the %s row kernel\n", isa_option);
+
+    /* before any allocation, so that the pages are placed by the threads that use them */
+    if(get_option(argc, argv, "-n", &placement_option, NULL) != 0 || (placement_option = (char*) placement_select(placement_option, placement_option != NULL || get_flag(argc, argv, "-A"))) == NULL) {
+        printf("error while reading the placement policy (-n), which should be first-touch, interleave or bind\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("using the %s placement policy\n", placement_option);
+
+    if(get_option(argc, argv, "-a", &arena_option, NULL) != 0 || (arena_option = (char*) arena_select(arena_option)) == NULL) {
+        printf("error while reading the allocator (-a), which should be malloc, aligned, thp or huge\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("using the %s allocator\n", arena_option);
+
+    if(get_flag(argc, argv, "-A")) {
+        int ncpus = placement_pin();
+        if(ncpus < 0) {
+            printf("error while pinning the threads (-A)\n");
+            return EXIT_FAILURE;
+        }
+        printf("pinned the threads on %d CPUs\n", ncpus);
+    }
+
+    /* batch mode (the rest of the options apply to each job) */
+    if(get_option(argc, argv, "-B", &batch_path, NULL) != 0) {
+        printf("error while reading the manifest (-B)\n");
+        return EXIT_FAILURE;
+    }
+
+    if(batch_path != NULL) {
+        if(checkpoint_path != NULL || restart_path != NULL || raw_path != NULL || telemetry_path != NULL || guess != GUESS_ZERO || get_flag(argc, argv, "-Z") || source_path != NULL || norm_option != NULL || check_option != NULL) {
+            printf("checkpoints (-C), restarts (-r), raw outputs (-O), telemetry (-T), initial guesses (-g), source terms (-f) and convergence checks (-E and -c) are not available in batch mode (-B)\n");
+            return EXIT_FAILURE;
+        }
+
+        if(get_flag(argc, argv, "-M") && (solver != JACOBI || precision != DOUBLE || depth > 1)) {
+            printf("solving several jobs at once (-M) is only available for the jacobi solver (without -b), in double precision\n");
+            return EXIT_FAILURE;
+        }
+
+        int failed = batch(batch_path, argc, argv, niter, threshold, solver, precision, depth, omega, get_flag(argc, argv, "-P"), get_flag(argc, argv, "-M"));
+        arena_release();
+        return (failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
     if(input_path == NULL) {
         printf("input (-i) is required\n");
         return EXIT_FAILURE;
@@ -91,81 +326,170 @@ int main(int argc, char* argv[]) {
     fclose(input);
 
     /* allocate */
-    width = in->width;
-    height = in->width;
+    if(get_grid_size(argc, argv, in, &width, &height) != 0) {
+        printf("error while reading the size of the grid (-W and -H)\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("using a grid of %dx%d\n", width, height);
+
+    /* with `-O`, the values live in the (memory-mapped) output file, so that there is nothing to write at the end */
+    FieldHeader raw_header = {.value_size = sizeof(FLT), .width = width, .height = height, .iterations = 0, .error = NAN};
+    void* raw_map = NULL;
+    FLT* values;
+
+    if(raw_path != NULL) {
+        raw_map = field_create(raw_path, &raw_header);
+        values = (raw_map != NULL) ? FIELD_VALUES(raw_map, &raw_header) : NULL;
+        if(values != NULL) {
+            grid_touch(values, width, height, sizeof(FLT)); // (the pages of a file are placed by first touch, whatever the policy)
+            if(placement_verbose)
+                grid_report(values, width, height, sizeof(FLT), raw_path);
+        }
+    } else
+        values = grid_alloc(width, height, sizeof(FLT)); // (zeroed)
 
-    FLT* values = malloc(width * height * sizeof(FLT));
     if (values == NULL) {
         printf("error while allocating values\n");
         return EXIT_FAILURE;
     }
 
     /* fill */
-    #pragma omp parallel for
-    for(int i=0; i < height; i++) {
-        for (int j = 0; j < width; j++) {
-            values[i * width + j] = .0;
+    fill_boundaries(in, values, width, height);
+
+    image_delete(in);
+
+    /* restart */
+    if(restart_path != NULL) {
+        FieldHeader header;
+        if(field_load(restart_path, values, width, height, &header) != 0) {
+            printf("error while reading the checkpoint %s (or its size does not match the input)\n", restart_path);
+            return EXIT_FAILURE;
         }
+
+        done = (int) header.iterations;
+        niter = (done < niter) ? niter - done : 0;
+        printf("restarting after %d iterations (error=%f)\n", done, header.error);
     }
 
-    for (int j=0; j < width; j++)  {
-        values[0 * width + j] = (FLT) (in->pixels[3*(TOP * in->width + j) + 0] - in->pixels[3* (TOP * in->width + j) + 2]) / 255;
-        values[(height-1) * width + j] = (FLT) (in->pixels[3*(BOTTOM * in->width + j) + 0] - in->pixels[3* (BOTTOM * in->width + j) + 2]) / 255;
-        values[j * width + 0] = (FLT) (in->pixels[3*(LEFT * in->width + j) + 0] - in->pixels[3* (LEFT* in->width + j) + 2]) / 255;
-        values[j * width + (width-1)] = (FLT) (in->pixels[3*(RIGHT * in->width + j) + 0] - in->pixels[3* (RIGHT * in->width + j) + 2]) / 255;
+    /* source term (for the Poisson equation) */
+    FLT* source = NULL;
+    if(source_path != NULL) {
+        source = grid_alloc(width, height, sizeof(FLT));
+        if(source == NULL || source_load(source, width, height, source_path) != 0) {
+            printf("error while reading the source term %s\n", source_path);
+            return EXIT_FAILURE;
+        }
+
+        printf("using the source term of %s\n", source_path);
     }
 
-    image_delete(in);
+    if(solver == SOR) {
+        if(omega_option == NULL)
+            omega = sor_omega_double(width, .1, height, .1);
+        printf("using SOR with omega=%f\n", omega);
+    }
 
-    /* compute */
-    struct timespec timer;
-    timer_start(&timer);
-    if(laplace(values, width, .1, height, .1, niter, threshold) != 0) {
-        printf("error while executing laplace()\n");
-        return EXIT_FAILURE;
+    /* convergence checks (see `convergence.h`) */
+    Convergence* convergence = NULL;
+    if(norm_option != NULL || check_option != NULL) {
+        convergence = convergence_new(norm, (check_option != NULL) ? atoi(check_option) : 1);
+        if(convergence == NULL) {
+            printf("error while allocating the convergence check\n");
+            return EXIT_FAILURE;
+        }
+        printf("checking the %s norm of the change every %d iterations (at least)\n", NORMS[norm], convergence->period);
     }
-    printf("total time = %.3f secs\n", timer_stop(&timer));
-    
-    /* save output */
-    if (output_path != NULL) {
 
-        /* find output range */
-        FLT max_positive = .0f, min_negative = .0f;
-        for(int i=0; i < height; i++) {
-            for(int j=0; j < width; j++) {
-                FLT val = values[i * width + j];
-                if (val < .0f)
-                    min_negative = fmin(min_negative, val);
-                else
-                    max_positive = fmax(max_positive, val);
-            }
+    /* reference solve from zero (to compare with the initial guess) */
+    struct timespec timer;
+    int reference = -1;
+    if(guess != GUESS_ZERO && get_flag(argc, argv, "-Z")) {
+        FLT* zero = grid_alloc(width, height, sizeof(FLT));
+        if(zero == NULL) {
+            printf("error while allocating values\n");
+            return EXIT_FAILURE;
         }
 
-        printf("min_negative = %.3f, max_positive = %.3f\n", min_negative, max_positive);
+        memcpy(zero, values, width * height * sizeof(FLT));
+        printf("solving from zero, for reference\n");
+        timer_start(&timer);
+        reference = solve(zero, source, width, height, niter, threshold, solver, precision, depth, omega, get_flag(argc, argv, "-P"), NULL, NULL, convergence);
+        printf("iterations from zero = %d (%.3f secs)\n", reference, timer_stop(&timer));
+        grid_free(zero);
+    }
 
-        Image* im = image_new(width, height);
-        for(int i=0; i < height; i++) {
-            for(int j=0; j < width; j++) {
-                FLT val = values[i * width + j];
-                if (val < .0f)
-                    im->pixels[3*(i * width + j) + 2] = (unsigned char) (val / min_negative * 255);
-                else
-                    im->pixels[3*(i * width + j) + 0] = (unsigned char) (val / max_positive * 255);
-            }
+    /* compute */
+    timer_start(&timer);
+
+    if(guess != GUESS_ZERO) {
+        /* (with a source, the error of the guesses is that of the Poisson equation) */
+        FLT* rhs = (source != NULL) ? source_rhs(source, width, .1, height, .1, (sizeof(FLT) == sizeof(float)) ? SINGLE : DOUBLE) : NULL;
+        if(source != NULL && rhs == NULL) {
+            printf("error while allocating the source term of the guess\n");
+            return EXIT_FAILURE;
         }
 
-        FILE* output = fopen(output_path, "w");
-        if (output == NULL) {
-            printf("error while opening output image\n");
+        FLT zero_error = guess_error(values, width, .1, height, .1, rhs);
+        int status = 0;
+
+        if(guess == GUESS_COONS)
+            guess_coons(values, width, height);
+        else if(guess == GUESS_COARSE)
+            status = guess_coarse(values, width, .1, height, .1, source);
+        else
+            status = guess_file(values, width, height, guess_option);
+
+        if(status != 0) {
+            printf("error while computing the initial guess (-g %s)\n", guess_option);
             return EXIT_FAILURE;
         }
 
-        image_write(im, output);
-        fclose(output);
+        printf("initial error=%f with the %s guess (instead of %f from zero), after %.3f secs\n", guess_error(values, width, .1, height, .1, rhs), (guess == GUESS_FILE) ? "file" : guess_option, zero_error, timer_stop(&timer));
+        grid_free(rhs);
+    }
+
+    Checkpoint* checkpoint = (checkpoint_path != NULL) ? checkpoint_new(checkpoint_path, period, done) : NULL;
+    Telemetry* telemetry = (telemetry_path != NULL) ? telemetry_new(telemetry_path, atoi(telemetry_option)) : NULL;
+    if((checkpoint_path != NULL && checkpoint == NULL) || (telemetry_path != NULL && telemetry == NULL)) {
+        printf("error while creating the checkpoint or telemetry file\n");
+        return EXIT_FAILURE;
+    }
+
+    int result = solve(values, source, width, height, niter, threshold, solver, precision, depth, omega, get_flag(argc, argv, "-P"), checkpoint, telemetry, convergence);
+    checkpoint_delete(checkpoint);
+    telemetry_delete(telemetry);
 
-        image_delete(im);
+    if(result < 0) {
+        printf("error while executing laplace()\n");
+        return EXIT_FAILURE;
     }
-    free(values);
+    printf("iterations = %d\n", ((solver == JACOBI || solver == SOR) ? done : 0) + result);
+    printf("total time = %.3f secs\n", timer_stop(&timer));
+
+    if(convergence != NULL) {
+        printf("convergence checks = %d\n", convergence->checks);
+        free(convergence);
+    }
+
+    if(reference > 0) // (not when the solve from zero converges at once)
+        printf("the %s guess saved %d iterations (%.1f%%)\n", (guess == GUESS_FILE) ? "file" : guess_option, reference - result, 100. * (reference - result) / reference);
+    
+    /* save output */
+    if (output_path != NULL) {
+        if(write_output(values, width, height, output_path) != 0) {
+            printf("error while writing output image\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    if(raw_map != NULL) {
+        ((FieldHeader*) raw_map)->iterations = ((solver == JACOBI || solver == SOR) ? done : 0) + result;
+        field_close(raw_map, &raw_header); // (the kernel writes the pages to disk)
+    } else
+        grid_free(values);
 
+    grid_free(source);
+    arena_release();
     return EXIT_SUCCESS;
 }
\ No newline at end of file
@@ -0,0 +1,435 @@
+/* MPI version of the 4-point jacobi stencil to solve the Laplace equation.
+ * The grid is split in tiles over a 2D cartesian topology of ranks, each tile having a ghost layer that is exchanged at every iteration.
+ * Compile it with `mpicc -o laplace.mpi 4_mpi.c image_ppm.c -lm -O1`.
+ * Run it with `mpirun -np 4 ./laplace.mpi -i example_input.ppm` (add `-a` to overlap communications and computations, or `-m cg` to use the conjugate gradient)
+ */
+
+#include "image_ppm.h"
+#include "common.h"
+#include <math.h>
+#include <mpi.h>
+
+#define ROOT 0
+
+#define MPI_FLT ((sizeof(FLT) == sizeof(double)) ? MPI_DOUBLE : MPI_FLOAT)
+
+#define G(x,y) (U[(y) * width + (x)])
+#define T(x,y) (tmp[(y) * width + (x)])
+
+typedef struct Tile_ {
+    /* Part of the grid which is handled by a rank.
+     *
+     * The tile contains `width x height` points, including a ghost layer of one point on each side.
+     * The ghost layer either contains the values of the neighbors (exchanged at each iteration) or, if the tile is on the edge of the grid, the boundary conditions.
+     * The point `(x, y)` of the tile is the point `(x0 + x - 1, y0 + y - 1)` of the grid.
+     */
+    MPI_Comm comm; // cartesian communicator
+    int north, south, west, east; // neighbors (may be `MPI_PROC_NULL`)
+    unsigned int x0, y0; // position of the first (non-ghost) point in the grid
+    unsigned int width, height; // including the ghost layer
+    MPI_Datatype column; // a column of the tile (without the ghost layer)
+} Tile;
+
+/* Distribute `n` points among `parts`: get the position of the first one and the number of points of part `i`.
+ */
+void distribute(unsigned int n, int parts, int i, unsigned int* start, unsigned int* count) {
+    *count = n / parts + ((unsigned int) i < n % parts ? 1 : 0);
+    *start = i * (n / parts) + ((unsigned int) i < n % parts ? i : n % parts);
+}
+
+/* Create the cartesian topology and get the tile of the current rank.
+ * Only the interior of the grid (i.e., without the first and last row/column) is distributed.
+ * Returns 0 on success, -1 if there is more ranks than points in a direction.
+ */
+int tile_new(Tile* tile, unsigned int grid_width, unsigned int grid_height) {
+    int comm_size, rank, dims[2] = {0, 0}, periods[2] = {0, 0}, coords[2];
+    unsigned int nx, ny;
+
+    MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+    MPI_Dims_create(comm_size, 2, dims);
+
+    if((unsigned int) dims[0] > grid_height - 2 || (unsigned int) dims[1] > grid_width - 2)
+        return -1;
+
+    MPI_Cart_create(MPI_COMM_WORLD, 2, dims, periods, 1, &tile->comm);
+    MPI_Comm_rank(tile->comm, &rank);
+    MPI_Cart_coords(tile->comm, rank, 2, coords);
+    MPI_Cart_shift(tile->comm, 0, 1, &tile->north, &tile->south);
+    MPI_Cart_shift(tile->comm, 1, 1, &tile->west, &tile->east);
+
+    distribute(grid_height - 2, dims[0], coords[0], &tile->y0, &ny);
+    distribute(grid_width - 2, dims[1], coords[1], &tile->x0, &nx);
+
+    tile->x0 += 1;
+    tile->y0 += 1;
+    tile->width = nx + 2;
+    tile->height = ny + 2;
+
+    MPI_Type_vector(ny, 1, tile->width, MPI_FLT, &tile->column);
+    MPI_Type_commit(&tile->column);
+
+    return 0;
+}
+
+void tile_delete(Tile* tile) {
+    MPI_Type_free(&tile->column);
+    MPI_Comm_free(&tile->comm);
+}
+
+/* Exchange the ghost layer of `U` with the neighbors.
+ */
+void exchange_halos(FLT* U, Tile* tile) {
+    unsigned int width = tile->width, height = tile->height;
+
+    MPI_Sendrecv(&G(1, 1), width - 2, MPI_FLT, tile->north, 0, &G(1, height - 1), width - 2, MPI_FLT, tile->south, 0, tile->comm, MPI_STATUS_IGNORE);
+    MPI_Sendrecv(&G(1, height - 2), width - 2, MPI_FLT, tile->south, 1, &G(1, 0), width - 2, MPI_FLT, tile->north, 1, tile->comm, MPI_STATUS_IGNORE);
+    MPI_Sendrecv(&G(1, 1), 1, tile->column, tile->west, 2, &G(width - 1, 1), 1, tile->column, tile->east, 2, tile->comm, MPI_STATUS_IGNORE);
+    MPI_Sendrecv(&G(width - 2, 1), 1, tile->column, tile->east, 3, &G(0, 1), 1, tile->column, tile->west, 3, tile->comm, MPI_STATUS_IGNORE);
+}
+
+/* Reduce `value` over all ranks with `op`.
+ */
+FLT allreduce(FLT value, MPI_Op op, Tile* tile) {
+    FLT result;
+    MPI_Allreduce(&value, &result, 1, MPI_FLT, op, tile->comm);
+    return result;
+}
+
+int is_root(Tile* tile) {
+    int rank;
+    MPI_Comm_rank(tile->comm, &rank);
+    return rank == ROOT;
+}
+
+/* the conjugate gradient works on the tiles, so it needs to exchange the halos and reduce the dot products */
+#define CG_EXCHANGE(v, context) exchange_halos(v, (Tile*) context)
+#define CG_SUM(value, context) allreduce(value, MPI_SUM, (Tile*) context)
+#define CG_MAX(value, context) allreduce(value, MPI_MAX, (Tile*) context)
+#define CG_ROOT(context) is_root((Tile*) context)
+
+#include "cg.h"
+
+/* Start the (non-blocking) exchange of the ghost layer of `U` with the neighbors.
+ * The exchange is completed by waiting for the 8 `requests`.
+ */
+void start_exchange_halos(FLT* U, Tile* tile, MPI_Request* requests) {
+    unsigned int width = tile->width, height = tile->height;
+
+    MPI_Irecv(&G(1, height - 1), width - 2, MPI_FLT, tile->south, 0, tile->comm, &requests[0]);
+    MPI_Irecv(&G(1, 0), width - 2, MPI_FLT, tile->north, 1, tile->comm, &requests[1]);
+    MPI_Irecv(&G(width - 1, 1), 1, tile->column, tile->east, 2, tile->comm, &requests[2]);
+    MPI_Irecv(&G(0, 1), 1, tile->column, tile->west, 3, tile->comm, &requests[3]);
+
+    MPI_Isend(&G(1, 1), width - 2, MPI_FLT, tile->north, 0, tile->comm, &requests[4]);
+    MPI_Isend(&G(1, height - 2), width - 2, MPI_FLT, tile->south, 1, tile->comm, &requests[5]);
+    MPI_Isend(&G(1, 1), 1, tile->column, tile->west, 2, tile->comm, &requests[6]);
+    MPI_Isend(&G(width - 2, 1), 1, tile->column, tile->east, 3, tile->comm, &requests[7]);
+}
+
+/* Apply the stencil to the points `[x_begin, x_end[ x [y_begin, y_end[` of the tile, and return the maximal change.
+ */
+FLT stencil(FLT* U, FLT* tmp, unsigned int width, int x_begin, int x_end, int y_begin, int y_end, FLT dx, FLT dy) {
+    FLT error = .0f;
+
+    for(int y=y_begin; y < y_end; y++) {
+        for(int x=x_begin; x < x_end; x++) {
+            T(x, y) = (dy * dy * ( G(x+1, y) + G(x-1, y) ) +  dx * dx * ( G(x, y+1) + G(x, y-1) )) / (2 * dx * dx + 2 * dy * dy);
+            error = fmax(error, fabs(G(x,y) - T(x,y)));
+        }
+    }
+
+    return error;
+}
+
+/* Compute the Laplace equation until the maximal change is lower than `threshold` or the number of iteration exceed `max_iter`.
+ * Each rank works on its tile, and the maximal change is reduced over all ranks.
+ * Returns the number of iterations, or -1 on error.
+ * The new values and the change are computed in a single pass, then the two buffers are swapped.
+ * If `overlap` is set, the halos are exchanged with non-blocking communications, while the interior of the tile is computed.
+ * Then, the outer ring of the tile is computed once the halos have arrived.
+ * U: function on the tile (including the ghost layer)
+ * tile: the tile
+ * max_iter: maximal number of iteration
+ * threshold: minimal change
+ * overlap: overlap communications and computations
+ */
+int laplace(FLT* U, Tile* tile, FLT dx, FLT dy, int max_iter, FLT threshold, int overlap) {
+    if(U != NULL) {
+        unsigned int width = tile->width, height = tile->height;
+        int rank, iter;
+        MPI_Comm_rank(tile->comm, &rank);
+
+        FLT* values = U;
+        FLT* tmp = malloc(width * height * sizeof(FLT));
+        if(tmp == NULL)
+            return -1;
+
+        /* both buffers hold the boundary conditions */
+        memcpy(tmp, U, width * height * sizeof(FLT));
+
+        FLT error = .0f, local_error;
+        MPI_Request requests[8];
+        double t_start, t_comm = .0, t_compute = .0, times[2];
+
+        for(iter=0; iter < max_iter; iter++) {
+            if(!overlap) {
+                t_start = MPI_Wtime();
+                exchange_halos(U, tile);
+                t_comm += MPI_Wtime() - t_start;
+
+                t_start = MPI_Wtime();
+                local_error = stencil(U, tmp, width, 1, width - 1, 1, height - 1, dx, dy);
+                t_compute += MPI_Wtime() - t_start;
+            } else {
+                t_start = MPI_Wtime();
+                start_exchange_halos(U, tile, requests);
+                local_error = stencil(U, tmp, width, 2, width - 2, 2, height - 2, dx, dy);
+                t_compute += MPI_Wtime() - t_start;
+
+                t_start = MPI_Wtime();
+                MPI_Waitall(8, requests, MPI_STATUSES_IGNORE);
+                t_comm += MPI_Wtime() - t_start;
+
+                t_start = MPI_Wtime();
+                local_error = fmax(local_error, stencil(U, tmp, width, 1, width - 1, 1, 2, dx, dy));
+                local_error = fmax(local_error, stencil(U, tmp, width, 1, width - 1, height - 2, height - 1, dx, dy));
+                local_error = fmax(local_error, stencil(U, tmp, width, 1, 2, 2, height - 2, dx, dy));
+                local_error = fmax(local_error, stencil(U, tmp, width, width - 2, width - 1, 2, height - 2, dx, dy));
+                t_compute += MPI_Wtime() - t_start;
+            }
+
+            /* the new values become the current ones */
+            FLT* swap = U;
+            U = tmp;
+            tmp = swap;
+
+            MPI_Allreduce(&local_error, &error, 1, MPI_FLT, MPI_MAX, tile->comm);
+
+            if (error < threshold) {
+                iter++;
+                break;
+            }
+        }
+
+        /* per-iteration timings of the slowest rank */
+        times[0] = t_comm / iter;
+        times[1] = t_compute / iter;
+        MPI_Reduce(rank == ROOT ? MPI_IN_PLACE : times, times, 2, MPI_DOUBLE, MPI_MAX, ROOT, tile->comm);
+
+        if(rank == ROOT) {
+            printf("final error=%f\n", error);
+            printf("per iteration: %s communication = %.3f ms, computation = %.3f ms\n", overlap ? "exposed" : "blocking", times[0] * 1000, times[1] * 1000);
+        }
+
+        /* the result must end up in the caller's buffer */
+        if(U != values) {
+            memcpy(values, U, width * height * sizeof(FLT));
+            tmp = U;
+        }
+
+        free(tmp);
+        return iter;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int niter, width, height;
+    int rank, comm_size, overlap, solver;
+    FLT threshold;
+    char *input_path, *output_path, *solver_option;
+    Image* in = NULL;
+    Tile tile;
+
+    MPI_Init(&argc, &argv);
+    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+    MPI_Comm_size(MPI_COMM_WORLD, &comm_size);
+
+    /* fetch inputs */
+    if(get_arguments(argc, argv, &niter, &threshold, &input_path, &output_path) != 0) {
+        if(rank == ROOT)
+            printf("error while reading command line\n");
+        MPI_Finalize();
+        return EXIT_FAILURE;
+    }
+
+    overlap = get_flag(argc, argv, "-a");
+
+    if(get_option(argc, argv, "-m", &solver_option, "jacobi") != 0 || ((solver = get_solver(solver_option)) != JACOBI && solver != CONJUGATE_GRADIENT)) {
+        if(rank == ROOT)
+            printf("error while reading the solver (-m), which should be `jacobi` or `cg`\n");
+        MPI_Finalize();
+        return EXIT_FAILURE;
+    }
+
+    if(input_path == NULL) {
+        if(rank == ROOT)
+            printf("input (-i) is required\n");
+        MPI_Finalize();
+        return EXIT_FAILURE;
+    }
+
+    /* read the boundary conditions, and share them */
+    unsigned int size[2] = {0, 0};
+    if(rank == ROOT) {
+        printf("using sizeof(FLT)=%d\n", sizeof(FLT));
+
+        FILE* input = fopen(input_path, "r");
+        if(input != NULL) {
+            in = image_new_from_file(input);
+            fclose(input);
+        }
+
+        if(in == NULL)
+            printf("error while reading input image\n");
+        else {
+            size[0] = in->width;
+            size[1] = in->height;
+        }
+    }
+
+    MPI_Bcast(size, 2, MPI_UNSIGNED, ROOT, MPI_COMM_WORLD);
+    if(size[0] == 0) {
+        MPI_Finalize();
+        return EXIT_FAILURE;
+    }
+
+    if(rank != ROOT)
+        in = image_new(size[0], size[1]);
+
+    MPI_Bcast(in->pixels, 3 * size[0] * size[1], MPI_UNSIGNED_CHAR, ROOT, MPI_COMM_WORLD);
+
+    if(get_grid_size(argc, argv, in, &width, &height) != 0) {
+        if(rank == ROOT)
+            printf("error while reading the size of the grid (-W and -H)\n");
+        MPI_Finalize();
+        return EXIT_FAILURE;
+    }
+
+    if(rank == ROOT)
+        printf("using a grid of %dx%d\n", width, height);
+
+    if(tile_new(&tile, width, height) != 0) {
+        if(rank == ROOT)
+            printf("too many ranks for a grid of %dx%d\n", width, height);
+        MPI_Finalize();
+        return EXIT_FAILURE;
+    }
+
+    /* allocate the tile */
+    FLT* U = malloc(tile.width * tile.height * sizeof(FLT));
+    if (U == NULL) {
+        printf("error while allocating values\n");
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    /* fill */
+    for(int i=0; i < tile.height; i++) {
+        for (int j = 0; j < tile.width; j++) {
+            U[i * tile.width + j] = .0;
+        }
+    }
+
+    if(tile.north == MPI_PROC_NULL) {
+        for (int j=0; j < tile.width; j++)
+            U[0 * tile.width + j] = boundary_value(in, TOP, tile.x0 - 1 + j, width);
+    }
+
+    if(tile.south == MPI_PROC_NULL) {
+        for (int j=0; j < tile.width; j++)
+            U[(tile.height - 1) * tile.width + j] = boundary_value(in, BOTTOM, tile.x0 - 1 + j, width);
+    }
+
+    if(tile.west == MPI_PROC_NULL) {
+        for (int j=0; j < tile.height; j++)
+            U[j * tile.width + 0] = boundary_value(in, LEFT, tile.y0 - 1 + j, height);
+    }
+
+    if(tile.east == MPI_PROC_NULL) {
+        for (int j=0; j < tile.height; j++)
+            U[j * tile.width + (tile.width - 1)] = boundary_value(in, RIGHT, tile.y0 - 1 + j, height);
+    }
+
+    /* compute */
+    struct timespec timer;
+    MPI_Barrier(MPI_COMM_WORLD);
+    if(rank == ROOT) {
+        int dims[2], periods[2], coords[2];
+        MPI_Cart_get(tile.comm, 2, dims, periods, coords);
+        printf("using %d ranks, as %dx%d tiles\n", comm_size, dims[1], dims[0]);
+        timer_start(&timer);
+    }
+
+    int result;
+    if(solver == CONJUGATE_GRADIENT)
+        result = laplace_cg(U, tile.width, .1, tile.height, .1, niter, threshold, get_flag(argc, argv, "-P"), &tile);
+    else
+        result = laplace(U, &tile, .1, .1, niter, threshold, overlap);
+
+    if(result < 0) {
+        printf("error while executing laplace()\n");
+        MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+    }
+
+    if(rank == ROOT)
+        printf("iterations = %d\n", result);
+
+    MPI_Barrier(MPI_COMM_WORLD);
+    if(rank == ROOT)
+        printf("total time = %.3f secs\n", timer_stop(&timer));
+
+    /* save output */
+    if (output_path != NULL) {
+        MPI_Datatype interior;
+        MPI_Type_vector(tile.height - 2, tile.width - 2, tile.width, MPI_FLT, &interior);
+        MPI_Type_commit(&interior);
+
+        if(rank != ROOT) {
+            unsigned int position[4] = {tile.x0, tile.y0, tile.width - 2, tile.height - 2};
+            MPI_Send(position, 4, MPI_UNSIGNED, ROOT, 0, tile.comm);
+            MPI_Send(&U[tile.width + 1], 1, interior, ROOT, 1, tile.comm);
+        } else {
+            /* gather the tiles */
+            FLT* values = malloc(width * height * sizeof(FLT));
+            if (values == NULL) {
+                printf("error while allocating values\n");
+                MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+            }
+
+            fill_boundaries(in, values, width, height);
+
+            for(int i=1; i < (tile.height - 1); i++) {
+                for(int j=1; j < (tile.width - 1); j++) {
+                    values[(tile.y0 + i - 1) * width + tile.x0 + j - 1] = U[i * tile.width + j];
+                }
+            }
+
+            for(int source=0; source < comm_size; source++) {
+                if(source == rank)
+                    continue;
+
+                unsigned int position[4];
+                MPI_Datatype block;
+                MPI_Recv(position, 4, MPI_UNSIGNED, source, 0, tile.comm, MPI_STATUS_IGNORE);
+                MPI_Type_vector(position[3], position[2], width, MPI_FLT, &block);
+                MPI_Type_commit(&block);
+                MPI_Recv(&values[position[1] * width + position[0]], 1, block, source, 1, tile.comm, MPI_STATUS_IGNORE);
+                MPI_Type_free(&block);
+            }
+
+            if(write_output(values, width, height, output_path) != 0) {
+                printf("error while writing output image\n");
+                MPI_Abort(MPI_COMM_WORLD, EXIT_FAILURE);
+            }
+            free(values);
+        }
+
+        MPI_Type_free(&interior);
+    }
+
+    image_delete(in);
+    free(U);
+    tile_delete(&tile);
+
+    MPI_Finalize();
+    return EXIT_SUCCESS;
+}
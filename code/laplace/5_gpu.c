@@ -16,16 +16,28 @@
 
 /* Compute the Laplace equation until the maximal change is lower than `threshold` or the number of iteration exceed `max_iter`.
  * The first and last row/column are used to get the values for the Dirichlet (i.e., fixed value) boundary conditions.
+ * The new values and the change are computed in a single pass, then the two buffers are swapped.
  * U: function
  * max_iter: maximal number of iteration
  * threshold: minimal change
  */
 int laplace(FLT* U, unsigned int width, FLT dx, unsigned int height, FLT dy, int max_iter, FLT threshold) {
     if(U != NULL) {
+        FLT* values = U;
         FLT* tmp = malloc(width * height * sizeof(FLT));
+        if(tmp == NULL)
+            return -1;
         
-        #pragma omp target data map(tofrom:U[0:width*height]) map(alloc:tmp[0:width*height])
+        #pragma omp target data map(tofrom:values[0:width*height]) map(alloc:tmp[0:width*height])
         {
+            /* both buffers hold the boundary conditions */
+            #pragma omp target teams distribute parallel for simd
+            for(int y=0; y < height; y++) {
+                for(int x=0; x < width; x++) {
+                    T(x, y) = G(x, y);
+                }
+            }
+
             FLT error = .0f;
             for(int iter=0; iter < max_iter; iter++) {
                 error = .0f;
@@ -37,13 +49,11 @@ int laplace(FLT* U, unsigned int width, FLT dx, unsigned int height, FLT dy, int
                         error = ffmax(error, fabs(G(x,y) - T(x,y)));
                     }
                 }
-                
-                #pragma omp target teams distribute parallel for simd
-                for(int y=1; y < (height - 1); y++) {
-                    for(int x=1; x < (width - 1); x++) {
-                        G(x,y) = T(x,y);
-                    }
-                }
+
+                /* the new values become the current ones (both buffers are on the device, so only the pointers are swapped) */
+                FLT* swap = U;
+                U = tmp;
+                tmp = swap;
 
                 if (error < threshold) {
                     break;
@@ -51,6 +61,16 @@ int laplace(FLT* U, unsigned int width, FLT dx, unsigned int height, FLT dy, int
             }
             
             printf("final error=%f\n", error);
+
+            /* the result must end up in the caller's buffer */
+            if(U != values) {
+                #pragma omp target teams distribute parallel for simd
+                for(int i=0; i < width * height; i++) {
+                    values[i] = U[i];
+                }
+
+                tmp = U;
+            }
         }
         
         free(tmp);
@@ -93,8 +113,12 @@ int main(int argc, char* argv[]) {
     fclose(input);
 
     /* allocate */
-    width = in->width;
-    height = in->width;
+    if(get_grid_size(argc, argv, in, &width, &height) != 0) {
+        printf("error while reading the size of the grid (-W and -H)\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("using a grid of %dx%d\n", width, height);
 
     FLT* values = malloc(width * height * sizeof(FLT));
     if (values == NULL) {
@@ -110,12 +134,7 @@ int main(int argc, char* argv[]) {
         }
     }
 
-    for (int j=0; j < width; j++)  {
-        values[0 * width + j] = (FLT) (in->pixels[3*(TOP * in->width + j) + 0] - in->pixels[3* (TOP * in->width + j) + 2]) / 255;
-        values[(height-1) * width + j] = (FLT) (in->pixels[3*(BOTTOM * in->width + j) + 0] - in->pixels[3* (BOTTOM * in->width + j) + 2]) / 255;
-        values[j * width + 0] = (FLT) (in->pixels[3*(LEFT * in->width + j) + 0] - in->pixels[3* (LEFT* in->width + j) + 2]) / 255;
-        values[j * width + (width-1)] = (FLT) (in->pixels[3*(RIGHT * in->width + j) + 0] - in->pixels[3* (RIGHT * in->width + j) + 2]) / 255;
-    }
+    fill_boundaries(in, values, width, height);
 
     image_delete(in);
 
@@ -131,42 +150,10 @@ int main(int argc, char* argv[]) {
     
     /* save output */
     if (output_path != NULL) {
-
-        /* find output range */
-        FLT max_positive = .0f, min_negative = .0f;
-        for(int i=0; i < height; i++) {
-            for(int j=0; j < width; j++) {
-                FLT val = values[i * width + j];
-                if (val < .0f)
-                    min_negative = fmin(min_negative, val);
-                else
-                    max_positive = fmax(max_positive, val);
-            }
-        }
-
-        printf("min_negative = %.3f, max_positive = %.3f\n", min_negative, max_positive);
-
-        Image* im = image_new(width, height);
-        for(int i=0; i < height; i++) {
-            for(int j=0; j < width; j++) {
-                FLT val = values[i * width + j];
-                if (val < .0f)
-                    im->pixels[3*(i * width + j) + 2] = (unsigned char) (val / min_negative * 255);
-                else
-                    im->pixels[3*(i * width + j) + 0] = (unsigned char) (val / max_positive * 255);
-            }
-        }
-
-        FILE* output = fopen(output_path, "w");
-        if (output == NULL) {
-            printf("error while opening output image\n");
+        if(write_output(values, width, height, output_path) != 0) {
+            printf("error while writing output image\n");
             return EXIT_FAILURE;
         }
-
-        image_write(im, output);
-        fclose(output);
-
-        image_delete(im);
     }
     
     free(values);
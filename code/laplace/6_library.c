@@ -0,0 +1,97 @@
+/* Example of use of the solver library (`laplace.h`): solve the problems of several input images with a single solver context.
+ * Compile it with `gcc -o laplace.lib 6_library.c image_ppm.c -lm -O1 -fopenmp`.
+ * Run it with `OMP_NUM_THREADS=4 ./laplace.lib example_input.ppm tests/input_1024.ppm` (add `-x serial` to use a single thread, `-m sor` to use another solver, `-t 1e-4` to change the threshold, `-W 512` to change the size of the grids, and `-e 100` to report the progress every 100 iterations).
+ * The results are written in `output_0.ppm`, `output_1.ppm`, etc.
+ */
+
+#include "image_ppm.h"
+#include "common.h"
+#include "laplace.h"
+
+/* Progress callback: print the error of the problem given by `data`.
+ */
+void progress(void* data, int iter, double error) {
+    printf("[%s] iteration %d, error=%f\n", (char*) data, iter, error);
+}
+
+int main(int argc, char* argv[]) {
+    char *backend_option, *solver_option, *threshold_option, *period_option;
+    if(get_option(argc, argv, "-x", &backend_option, "omp") != 0 || get_option(argc, argv, "-m", &solver_option, "jacobi") != 0 || get_option(argc, argv, "-t", &threshold_option, NULL) != 0 || get_option(argc, argv, "-e", &period_option, "0") != 0) {
+        printf("missing value after an option\n");
+        return EXIT_FAILURE;
+    }
+
+    int backend = get_choice(BACKENDS, backend_option);
+    LaplaceSolver* solver = laplace_solver_new(backend);
+    if(solver == NULL) {
+        printf("the %s backend is not available\n", backend_option);
+        return EXIT_FAILURE;
+    }
+
+    solver->solver = get_solver(solver_option);
+    if(solver->solver < 0) {
+        printf("unknown solver %s\n", solver_option);
+        laplace_solver_delete(solver);
+        return EXIT_FAILURE;
+    }
+
+    if(threshold_option != NULL)
+        solver->threshold = atof(threshold_option);
+
+    /* the inputs are the arguments which are neither an option nor its value */
+    int ninputs = 0;
+    for(int i=1; i < argc; i++) {
+        if(argv[i][0] == '-') {
+            i++;
+            continue;
+        }
+
+        FILE* input = fopen(argv[i], "r");
+        if(input == NULL) {
+            printf("cannot open %s\n", argv[i]);
+            continue;
+        }
+
+        Image* in = image_new_from_file(input);
+        fclose(input);
+        if(in == NULL) {
+            printf("error while reading %s\n", argv[i]);
+            continue;
+        }
+
+        unsigned int width, height;
+        if(get_grid_size(argc, argv, in, &width, &height) != 0 || laplace_solver_setup(solver, width, height) != 0) {
+            printf("error while setting up a %dx%d grid\n", width, height);
+            image_delete(in);
+            continue;
+        }
+
+        laplace_solver_image(solver, in);
+        image_delete(in);
+
+        if(atoi(period_option) > 0)
+            laplace_solver_progress(solver, progress, argv[i], atoi(period_option));
+
+        struct timespec start;
+        timer_start(&start);
+        int iterations = laplace_solver_solve(solver);
+        double elapsed = timer_stop(&start);
+
+        if(iterations < 0) {
+            printf("error while solving %s\n", argv[i]);
+            continue;
+        }
+
+        char output_path[64];
+        snprintf(output_path, sizeof(output_path), "output_%d.ppm", ninputs++);
+        printf("%s: %dx%d, %d iterations in %.3f secs (%s backend), written in %s\n", argv[i], width, height, iterations, elapsed, BACKENDS[backend], output_path);
+
+        if(write_output(solver->values, width, height, output_path) != 0)
+            printf("error while writing %s\n", output_path);
+    }
+
+    laplace_solver_delete(solver);
+    arena_release();
+
+    return (ninputs > 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,151 @@
+/* OMP version of the 7-point jacobi stencil to solve the Laplace equation in 3D (see `laplace3d.h`).
+ * Compile it with `gcc -o laplace.3d 7_3d.c image_ppm.c -lm -O1 -fopenmp`.
+ * Run it with `OMP_NUM_THREADS=4 ./laplace.3d -i example_faces.ppm -W 128` (the grid is `W x H x D`, with `-H` and `-D` equal to `-W` by default; add `-m sor` to use red-black SOR, with `-w x.xx` to set its relaxation factor, `-R volume.raw` to read the boundary conditions from a raw file instead of a stack of images, `-o slice.ppm` to get the middle plane as an image, `-O volume.raw` to get all the values in a raw file, `-n interleave` or `-n bind` to change the NUMA placement of the grids, and `-A` to pin the threads)
+ */
+
+#include "image_ppm.h"
+#include "common.h"
+#include "placement.h"
+#include "laplace3d.h"
+
+/* Get the size of the grid, with `-W xx` (`default_width` by default), `-H yy` and `-D zz` (the width by default).
+ * Returns 0 on success, -1 if the size is invalid (there should be at least 3 points in each direction).
+ */
+int get_grid_size3d(int argc, char* argv[], unsigned int default_width, unsigned int* width, unsigned int* height, unsigned int* depth) {
+    char *width_option, *height_option, *depth_option;
+    if(get_option(argc, argv, "-W", &width_option, NULL) != 0 || get_option(argc, argv, "-H", &height_option, NULL) != 0 || get_option(argc, argv, "-D", &depth_option, NULL) != 0)
+        return -1;
+
+    *width = (width_option != NULL) ? ((atoi(width_option) > 0) ? atoi(width_option) : 0) : default_width;
+    *height = (height_option != NULL) ? ((atoi(height_option) > 0) ? atoi(height_option) : 0) : *width;
+    *depth = (depth_option != NULL) ? ((atoi(depth_option) > 0) ? atoi(depth_option) : 0) : *width;
+
+    return (*width < 3 || *height < 3 || *depth < 3) ? -1 : 0;
+}
+
+int main(int argc, char* argv[]) {
+    unsigned int niter, width, height, depth;
+    FLT threshold;
+    char *input_path, *output_path, *raw_path, *volume_path, *solver_option, *omega_option, *placement_option;
+
+    printf("using sizeof(FLT)=%d\n", sizeof(FLT));
+
+    /* fetch inputs */
+    if(get_arguments(argc, argv, &niter, &threshold, &input_path, &output_path) != 0 || get_option(argc, argv, "-R", &raw_path, NULL) != 0 || get_option(argc, argv, "-O", &volume_path, NULL) != 0 || get_option(argc, argv, "-m", &solver_option, "jacobi") != 0 || get_option(argc, argv, "-w", &omega_option, NULL) != 0) {
+        printf("error while reading command line\n");
+        return EXIT_FAILURE;
+    }
+
+    int solver = get_solver(solver_option);
+    if(solver != JACOBI && solver != SOR) {
+        printf("the 3D version only provides the jacobi and sor solvers\n");
+        return EXIT_FAILURE;
+    }
+
+    FLT omega = .0f;
+    if(omega_option != NULL && ((omega = atof(omega_option)) <= 0 || omega >= 2)) {
+        printf("error while reading the relaxation factor (-w), which should be between 0 and 2\n");
+        return EXIT_FAILURE;
+    }
+
+    if((input_path == NULL) == (raw_path == NULL)) {
+        printf("either a stack of images (-i) or a raw file (-R) is required\n");
+        return EXIT_FAILURE;
+    }
+
+    if(get_option(argc, argv, "-n", &placement_option, NULL) != 0 || (placement_option = (char*) placement_select(placement_option, placement_option != NULL || get_flag(argc, argv, "-A"))) == NULL) {
+        printf("unknown placement policy (-n)\n");
+        return EXIT_FAILURE;
+    }
+
+    if(get_flag(argc, argv, "-A") && placement_pin() < 0) {
+        printf("error while pinning the threads (-A)\n");
+        return EXIT_FAILURE;
+    }
+
+    Image* in = NULL;
+    if(input_path != NULL) {
+        FILE* input = fopen(input_path, "r");
+        if(input == NULL) {
+            printf("error while opening input image\n");
+            return EXIT_FAILURE;
+        }
+
+        in = image_new_from_file(input);
+        fclose(input);
+        if(in == NULL) {
+            printf("error while reading input image\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    /* allocate */
+    if(get_grid_size3d(argc, argv, (in != NULL) ? in->width : 0, &width, &height, &depth) != 0) {
+        printf("error while reading the size of the grid (-W, -H and -D)\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("using a grid of %dx%dx%d\n", width, height, depth);
+
+    FLT* values = grid_alloc(width * height, depth, sizeof(FLT));
+    if(values == NULL) {
+        printf("error while allocating values\n");
+        return EXIT_FAILURE;
+    }
+
+    /* fill */
+    if(in != NULL) {
+        if(fill_faces(in, values, width, height, depth) != 0) {
+            printf("the input image should contain %d faces\n", FACES);
+            return EXIT_FAILURE;
+        }
+
+        image_delete(in);
+    } else if(read_raw(raw_path, values, width, height, depth) != 0) {
+        printf("error while reading %s (%dx%dx%d values of %d bytes)\n", raw_path, width, height, depth, sizeof(FLT));
+        return EXIT_FAILURE;
+    }
+
+    /* compute */
+    struct timespec timer;
+    timer_start(&timer);
+
+    int iterations;
+    if(solver == SOR) {
+        if(omega_option == NULL)
+            omega = sor_omega3d(width, .1, height, .1, depth, .1);
+        printf("using SOR, with omega=%f\n", omega);
+        iterations = laplace3d_sor(values, width, .1, height, .1, depth, .1, niter, threshold, omega);
+    } else
+        iterations = laplace3d(values, width, .1, height, .1, depth, .1, niter, threshold);
+
+    if(iterations < 0) {
+        printf("error while executing laplace3d()\n");
+        return EXIT_FAILURE;
+    }
+
+    double elapsed = timer_stop(&timer), updates = (double) iterations * (width - 2) * (height - 2) * (depth - 2);
+    printf("iterations = %d\n", iterations);
+    printf("total time = %.3f secs\n", elapsed);
+    printf("throughput = %.3f Gupdates/s, %.3f GB/s (estimated)\n", updates / elapsed * 1e-9, updates / elapsed * ((solver == SOR) ? 3 : 2) * sizeof(FLT) * 1e-9);
+
+    /* save output */
+    if(output_path != NULL) {
+        if(write_output(&values[(size_t) (depth / 2) * width * height], width, height, output_path) != 0) {
+            printf("error while writing output image\n");
+            return EXIT_FAILURE;
+        }
+    }
+
+    if(volume_path != NULL) {
+        if(write_raw(volume_path, values, width, height, depth) != 0) {
+            printf("error while writing %s\n", volume_path);
+            return EXIT_FAILURE;
+        }
+    }
+
+    grid_free(values);
+    arena_release();
+
+    return EXIT_SUCCESS;
+}
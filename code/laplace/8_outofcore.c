@@ -0,0 +1,128 @@
+/* Out-of-core version: the grid lives in a file, and is streamed through memory by bands of rows (see `outofcore.h`), so that it can be larger than the memory.
+ * Compile it with `gcc -o laplace.ooc 8_outofcore.c image_ppm.c -lm -O1 -fopenmp`.
+ * Run it with `OMP_NUM_THREADS=4 ./laplace.ooc -i example_input.ppm -W 65536 -F field.bin -L 1024` (the file given by `-F` is created from the boundary conditions of `-i`, or, without `-i`, the iterations continue from its values; add `-L 256` to use at most 256 MiB of memory for the bands, `-b 16` to perform 16 iterations per pass over the file, and `-o output.ppm` to get the result as an image)
+ */
+
+#include "image_ppm.h"
+#include "common.h"
+#include "simd.h"
+#include "placement.h"
+#include "field.h"
+#include "outofcore.h"
+
+#define DEFAULT_MEMORY 1024 // memory cap (in MiB) of the bands, if `-L` is not given
+#define DEFAULT_DEPTH 8 // iterations per pass, if `-b` is not given
+
+int main(int argc, char* argv[]) {
+    unsigned int niter, width, height;
+    FLT threshold;
+    char *input_path, *output_path, *field_path, *memory_option, *depth_option;
+
+    printf("using sizeof(FLT)=%d\n", sizeof(FLT));
+
+    /* fetch inputs */
+    if(get_arguments(argc, argv, &niter, &threshold, &input_path, &output_path) != 0 || get_option(argc, argv, "-F", &field_path, NULL) != 0 || field_path == NULL) {
+        printf("error while reading command line (the file of the grid, -F, is required)\n");
+        return EXIT_FAILURE;
+    }
+
+    int depth;
+    if(get_option(argc, argv, "-b", &depth_option, NULL) != 0 || (depth = (depth_option != NULL) ? atoi(depth_option) : DEFAULT_DEPTH) < 1) {
+        printf("error while reading the number of iterations per pass (-b)\n");
+        return EXIT_FAILURE;
+    }
+
+    size_t memory;
+    if(get_option(argc, argv, "-L", &memory_option, NULL) != 0 || (memory = (size_t) (((memory_option != NULL) ? atof(memory_option) : DEFAULT_MEMORY) * (1 << 20))) == 0) {
+        printf("error while reading the memory cap (-L, in MiB)\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("using the %s row kernel\n", simd_select(NULL));
+
+    /* create the file from the input image */
+    if(input_path != NULL) {
+        FILE* input = fopen(input_path, "r");
+        if(input == NULL) {
+            printf("error while opening input image\n");
+            return EXIT_FAILURE;
+        }
+
+        Image* in = image_new_from_file(input);
+        fclose(input);
+        if(in == NULL) {
+            printf("error while reading input image\n");
+            return EXIT_FAILURE;
+        }
+
+        if(get_grid_size(argc, argv, in, &width, &height) != 0) {
+            printf("error while reading the size of the grid (-W and -H)\n");
+            return EXIT_FAILURE;
+        }
+
+        if(ooc_create(field_path, in, width, height) != 0) {
+            printf("error while creating %s\n", field_path);
+            return EXIT_FAILURE;
+        }
+
+        image_delete(in);
+    }
+
+    /* open the file */
+    FieldHeader header;
+    void* map = field_open(field_path, &header);
+    if(map == NULL || header.value_size != sizeof(FLT)) {
+        printf("%s is not a grid of values of %d bytes\n", field_path, sizeof(FLT));
+        return EXIT_FAILURE;
+    }
+
+    field_close(map, &header);
+
+    width = header.width;
+    height = header.height;
+    printf("using a grid of %dx%d in %s (%.1f GiB), after %ld iterations\n", width, height, field_path, (double) width * height * sizeof(FLT) / (1 << 30), (long) header.iterations);
+
+    unsigned int rows = ooc_rows(memory, width, height, depth);
+    if(rows == 0) {
+        printf("the memory cap (-L) is too small: the bands need at least %d rows\n", depth);
+        return EXIT_FAILURE;
+    }
+
+    printf("using bands of %u rows (%.1f MiB of memory), with %d iterations per pass\n", rows, (double) OOC_WINDOWS * (rows + 2 * depth) * width * sizeof(FLT) / (1 << 20), depth);
+
+    int fd = open(field_path, O_RDWR);
+    if(fd < 0) {
+        printf("error while opening %s\n", field_path);
+        return EXIT_FAILURE;
+    }
+
+    /* compute */
+    struct timespec timer;
+    timer_start(&timer);
+
+    int iterations = laplace_ooc(fd, &header, .1, .1, niter, threshold, rows, depth);
+    close(fd);
+
+    if(iterations < 0) {
+        printf("error while executing laplace_ooc()\n");
+        return EXIT_FAILURE;
+    }
+
+    printf("iterations = %d\n", iterations);
+    printf("total time = %.3f secs\n", timer_stop(&timer));
+
+    /* save output (the file is mapped, so that its pages are read as they are needed) */
+    if(output_path != NULL) {
+        map = field_open(field_path, &header);
+        if(map == NULL || write_output(FIELD_VALUES(map, &header), width, height, output_path) != 0) {
+            printf("error while writing output image\n");
+            return EXIT_FAILURE;
+        }
+
+        field_close(map, &header);
+    }
+
+    arena_release();
+
+    return EXIT_SUCCESS;
+}
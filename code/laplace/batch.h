@@ -0,0 +1,185 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+/* Batch mode: solve the problems listed in a manifest, within a single process.
+ *
+ * The manifest contains one job per line, as `input.ppm output.ppm` (or `-i input.ppm -o output.ppm`), empty lines and lines starting with `#` being ignored.
+ * The jobs are processed by chunks (of one job, or of `MULTI_CHUNK` jobs which are solved together, see `multi.h`), which are pipelined over three stages:
+ * 1. a thread reads the input images of the next chunk (`batch_read()`),
+ * 2. the OMP threads compute the current chunk,
+ * 3. another thread writes the output images of the previous chunk (`batch_write()`).
+ * Thus, as long as the I/O of a chunk takes less time than the computation of the next one, the OMP threads never wait for it.
+ * The grids (and the buffers of the solvers) are obtained from the arena (see `../arena.h`), so that they are reused from one job to the next.
+ *
+ * Requires `common.h` (for `write_output()`) and `placement.h` (for `grid_free()`).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <omp.h>
+
+#define MULTI_CHUNK (4 * MULTI_LANES) // number of jobs per chunk, when they are solved together
+
+typedef struct BatchJob_ {
+    char* input;
+    char* output;
+
+    Image* image; // (set by `batch_read()`, NULL on error)
+
+    /* result (written by `batch_write()`) */
+    FLT* values;
+    unsigned int width, height;
+    int status; // of `write_output()`
+} BatchJob;
+
+typedef struct BatchChunk_ {
+    BatchJob* jobs;
+    int njobs;
+} BatchChunk;
+
+/* Read the manifest at `path`.
+ * Returns the list of jobs (and their number in `njobs`), or NULL on error (the line of the error is then given in `njobs`).
+ */
+BatchJob* batch_load(const char* path, int* njobs) {
+    FILE* f = fopen(path, "r");
+    *njobs = 0;
+    if(f == NULL)
+        return NULL;
+
+    BatchJob* jobs = NULL;
+    char line[4096];
+    int n = 0, capacity = 0, lineno = 0;
+
+    while(fgets(line, sizeof(line), f) != NULL) {
+        char *tokens[4], *saveptr;
+        int ntokens = 0;
+        lineno++;
+
+        for(char* token = strtok_r(line, " \t\r\n", &saveptr); token != NULL && ntokens < 4; token = strtok_r(NULL, " \t\r\n", &saveptr))
+            tokens[ntokens++] = token;
+
+        if(ntokens == 0 || tokens[0][0] == '#')
+            continue;
+
+        char *input = NULL, *output = NULL;
+        if(ntokens == 2) {
+            input = tokens[0];
+            output = tokens[1];
+        } else if(ntokens == 4) {
+            for(int i=0; i < 4; i += 2) {
+                if(strcmp(tokens[i], "-i") == 0)
+                    input = tokens[i + 1];
+                else if(strcmp(tokens[i], "-o") == 0)
+                    output = tokens[i + 1];
+            }
+        }
+
+        if(input == NULL || output == NULL) {
+            fclose(f);
+            free(jobs);
+            *njobs = lineno;
+            return NULL;
+        }
+
+        if(n == capacity) {
+            capacity = (capacity == 0) ? 64 : 2 * capacity;
+            jobs = realloc(jobs, capacity * sizeof(BatchJob));
+            if(jobs == NULL) {
+                fclose(f);
+                return NULL;
+            }
+        }
+
+        jobs[n++] = (BatchJob) {.input = strdup(input), .output = strdup(output), .image = NULL, .values = NULL};
+    }
+
+    fclose(f);
+    *njobs = n;
+    return (jobs != NULL) ? jobs : calloc(1, sizeof(BatchJob)); // (an empty manifest is not an error)
+}
+
+/* Free the jobs (their grids should already be freed).
+ */
+void batch_delete(BatchJob* jobs, int njobs) {
+    for(int i=0; i < njobs; i++) {
+        free(jobs[i].input);
+        free(jobs[i].output);
+    }
+
+    free(jobs);
+}
+
+/* (thread) read the input images of a chunk.
+ */
+void* batch_read(void* arg) {
+    BatchChunk* chunk = arg;
+
+    for(int i=0; i < chunk->njobs; i++) {
+        BatchJob* job = &chunk->jobs[i];
+        job->image = NULL;
+
+        FILE* input = fopen(job->input, "r");
+        if(input != NULL) {
+            job->image = image_new_from_file(input);
+            fclose(input);
+        }
+    }
+
+    return NULL;
+}
+
+/* (thread) write the output images of a chunk (the jobs without values are skipped).
+ * The images are encoded by this thread alone, so that it does not compete with the OMP threads of the next chunk.
+ */
+void* batch_write(void* arg) {
+    BatchChunk* chunk = arg;
+
+    omp_set_num_threads(1); // (only for the parallel regions started by this thread)
+    for(int i=0; i < chunk->njobs; i++) {
+        BatchJob* job = &chunk->jobs[i];
+        if(job->values != NULL)
+            job->status = write_output(job->values, job->width, job->height, job->output);
+    }
+
+    return NULL;
+}
+
+/* Run `stage` on `chunk` in a new thread (stored in `thread`), or directly if the thread cannot be created.
+ * Returns 1 if a thread was created (and should be joined), 0 otherwise.
+ */
+int batch_start(pthread_t* thread, void* (*stage)(void*), BatchChunk* chunk) {
+    if(pthread_create(thread, NULL, stage, chunk) == 0)
+        return 1;
+
+    stage(chunk);
+    return 0;
+}
+
+/* Wait for the output of `chunk` (if `running`, in `thread`), then free its grids.
+ * Returns the number of images that could not be written.
+ */
+int batch_finish(pthread_t* thread, int running, BatchChunk* chunk) {
+    int failed = 0;
+    if(running)
+        pthread_join(*thread, NULL);
+
+    for(int i=0; i < chunk->njobs; i++) {
+        BatchJob* job = &chunk->jobs[i];
+        if(job->values == NULL)
+            continue;
+
+        if(job->status != 0) {
+            printf("error while writing %s\n", job->output);
+            failed++;
+        }
+
+        grid_free(job->values);
+        job->values = NULL;
+    }
+
+    return failed;
+}
+
+#endif // BATCH_H
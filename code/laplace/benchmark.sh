@@ -0,0 +1,103 @@
+#!/bin/bash
+
+function _in {
+  # credits: https://stackoverflow.com/a/8574392
+  local e match="$1"
+  shift
+  for e; do [[ "$e" == "$match" ]] && return 0; done
+  return 1
+}
+
+# a fixed number of iterations, so that the timings are comparable
+NITER=100
+
+# serial
+if $(_in "+full" "$@") || $(_in "+serial" "$@") ; then
+  exec="bench_laplace_serial"
+  gcc -o $exec 1_serial.c image_ppm.c -lm -O1
+  for size in 1024 2048 4096; do
+    echo -n "Serial $size | " & ./$exec -i tests/input_$size.ppm -N $NITER | grep "total time"
+  done
+  rm $exec
+  fi
+
+# OMP
+if $(_in "+full" "$@") || $(_in "+omp" "$@") ; then
+  exec="bench_laplace_omp"
+  gcc -o $exec 3_omp.c image_ppm.c -lm -O1 -fopenmp
+  for size in 1024 2048 4096 8192; do
+    for nthreads in 1 2 4 8 16; do
+      export OMP_NUM_THREADS=$nthreads
+      echo -n "OMP $size ${nthreads}T | " & ./$exec -i tests/input_$size.ppm -N $NITER | grep "total time"
+    done
+  done
+  rm $exec
+  fi
+
+# MPI, strong scaling (same grid, more ranks)
+if $(_in "+full" "$@") || $(_in "+mpi" "$@") ; then
+  exec="bench_laplace_mpi"
+  mpicc -o $exec 4_mpi.c image_ppm.c -lm -O1
+  for size in 4096 8192 16384; do
+    for np in 1 2 4 8 16; do
+      echo -n "MPI $size ${np}P | " & mpirun -np $np ./$exec -i tests/input_$size.ppm -N $NITER | grep "total time"
+      echo -n "MPI $size ${np}P (overlap) | " & mpirun -np $np ./$exec -i tests/input_$size.ppm -N $NITER -a | grep "total time"
+    done
+  done
+  rm $exec
+  fi
+
+# MPI, weak scaling (same grid per rank)
+if $(_in "+full" "$@") || $(_in "+mpi-weak" "$@") ; then
+  exec="bench_laplace_mpi"
+  mpicc -o $exec 4_mpi.c image_ppm.c -lm -O1
+  echo -n "MPI 1024 1P  | " & mpirun -np 1 ./$exec -i tests/input_1024.ppm -N $NITER | grep "total time"
+  echo -n "MPI 2048 4P  | " & mpirun -np 4 ./$exec -i tests/input_2048.ppm -N $NITER | grep "total time"
+  echo -n "MPI 4096 16P | " & mpirun -np 16 ./$exec -i tests/input_4096.ppm -N $NITER | grep "total time"
+  echo -n "MPI 8192 64P | " & mpirun -np 64 ./$exec -i tests/input_8192.ppm -N $NITER | grep "total time"
+  echo -n "MPI 16384 256P | " & mpirun -np 256 ./$exec -i tests/input_16384.ppm -N $NITER | grep "total time"
+  rm $exec
+  fi
+
+# 3D (the boundary conditions are resampled from the same stack of images)
+if $(_in "+full" "$@") || $(_in "+3d" "$@") ; then
+  exec="bench_laplace_3d"
+  gcc -o $exec 7_3d.c image_ppm.c -lm -O1 -fopenmp
+  for size in 512 768 1024; do
+    for nthreads in 1 2 4 8 16; do
+      export OMP_NUM_THREADS=$nthreads
+      echo -n "3D $size ${nthreads}T | " & ./$exec -i example_faces.ppm -W $size -N $NITER | grep "total time"
+      echo -n "3D $size ${nthreads}T (sor) | " & ./$exec -i example_faces.ppm -W $size -N $NITER -m sor | grep "total time"
+    done
+  done
+  rm $exec
+  fi
+
+# out-of-core, with 1 GiB of memory for the bands (the 65536 grid is a 32 GiB file)
+if $(_in "+full" "$@") || $(_in "+ooc" "$@") ; then
+  exec="bench_laplace_ooc"
+  gcc -o $exec 8_outofcore.c image_ppm.c -lm -O1 -fopenmp
+  for size in 16384 32768 65536; do
+    for depth in 1 4 16; do
+      echo -n "OOC $size -b $depth | " & ./$exec -i example_input.ppm -W $size -F bench_field.bin -L 1024 -b $depth -N $NITER | grep "total time"
+    done
+  done
+  rm -f $exec bench_field.bin
+  fi
+
+# convergence checks: with `-c k`, jacobi and SOR should stop at most `k - 1` iterations after the run checked at each iteration (`-c 1`, see `convergence.h`)
+if $(_in "+full" "$@") || $(_in "+convergence" "$@") ; then
+  exec="bench_laplace_omp"
+  gcc -o $exec 3_omp.c image_ppm.c -lm -O1 -fopenmp
+  for method in jacobi sor; do
+    for threshold in 1e-3 1e-4 1e-5; do
+      base=$(./$exec -i example_input.ppm -m $method -t $threshold -N 100000 -c 1 | grep "^iterations" | cut -d " " -f 3)
+      for period in 2 10 50; do
+        iter=$(./$exec -i example_input.ppm -m $method -t $threshold -N 100000 -c $period | grep "^iterations" | cut -d " " -f 3)
+        if [ $iter -ge $base ] && [ $iter -lt $((base + period)) ]; then result="ok"; else result="FAILED"; fi
+        echo "Convergence $method -t $threshold -c $period | $iter iterations (instead of $base): $result"
+      done
+    done
+  done
+  rm $exec
+  fi
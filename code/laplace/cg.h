@@ -0,0 +1,133 @@
+#ifndef CG_H
+#define CG_H
+
+/* Matrix-free conjugate gradient (CG) solver for the Laplace equation (Dirichlet boundary conditions), built on the BLAS-1 kernels of `../linear_algebra/blas1.h`.
+ *
+ * The equation is written as `L u = 0`, where `L u = (2/dx^2 + 2/dy^2) u - (u_east + u_west) / dx^2 - (u_north + u_south) / dy^2` is the (symmetric positive definite) 5-point operator.
+ * Starting from `U`, CG solves `L e = r` for the correction `e`, with homogeneous boundary conditions, where `r = -L U` is the initial residual.
+ * All the vectors are `width x height` arrays (the outer ring being kept to zero), so that the BLAS-1 kernels work on the whole arrays.
+ *
+ * For distributed versions, where the outer ring is a ghost layer for some sides, define before including this file:
+ * - `CG_EXCHANGE(v, context)`, which exchanges the ghost layer of `v`,
+ * - `CG_SUM(value, context)` and `CG_MAX(value, context)`, which reduce `value` over all the parts of the grid,
+ * - `CG_ROOT(context)`, which is true for the part which should print the results.
+ *
+ * Requires `common.h` (for `FLT` and `ffmax()`).
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include "../linear_algebra/blas1.h"
+
+#ifndef CG_EXCHANGE
+#define CG_EXCHANGE(v, context) // nothing to exchange
+#define CG_SUM(value, context) (value)
+#define CG_MAX(value, context) (value)
+#define CG_ROOT(context) 1
+#endif
+
+/* BLAS-1 kernels in the precision of `FLT` */
+#define AXPY(n, alpha, x, y) _Generic((x), float*: saxpy, double*: daxpy)(n, alpha, x, y)
+#define DOT(n, x, y) _Generic((x), float*: sdot, double*: ddot)(n, x, y)
+#define SCAL(n, alpha, x) _Generic((x), float*: sscal, double*: dscal)(n, alpha, x)
+
+/* Compute `q = L p` on the interior points.
+ */
+void cg_apply(FLT* p, FLT* q, unsigned int width, FLT dx, unsigned int height, FLT dy) {
+    FLT cx = 1 / (dx * dx), cy = 1 / (dy * dy), diag = 2 * cx + 2 * cy;
+
+    #pragma omp parallel for
+    for(int y=1; y < (height - 1); y++) {
+        for(int x=1; x < (width - 1); x++) {
+            int i = y * width + x;
+            q[i] = diag * p[i] - cx * (p[i+1] + p[i-1]) - cy * (p[i+width] + p[i-width]);
+        }
+    }
+}
+
+/* Get the maximal absolute value of `v`.
+ */
+FLT cg_max(FLT* v, int n) {
+    FLT value = .0f;
+
+    #pragma omp parallel for reduction(max:value)
+    for(int i=0; i < n; i++)
+        value = ffmax(value, fabs(v[i]));
+
+    return value;
+}
+
+/* Compute the Laplace equation with the conjugate gradient, until the maximal change (that a jacobi iteration would make) is lower than `threshold` or the number of iteration exceed `max_iter`.
+ * The first and last row/column are used to get the values for the Dirichlet (i.e., fixed value) boundary conditions.
+ * If `precondition` is set, the jacobi (i.e., diagonal) preconditioner is used. Note that since the diagonal of `L` is constant, it only scales the residual (and thus does not change the iterates).
+ * Returns the number of iterations, or -1 on error.
+ * U: function
+ * max_iter: maximal number of iteration
+ * threshold: minimal change
+ * precondition: use the jacobi preconditioner
+ * context: passed to the `CG_*` macros
+ */
+int laplace_cg(FLT* U, unsigned int width, FLT dx, unsigned int height, FLT dy, int max_iter, FLT threshold, int precondition, void* context) {
+    if(U != NULL) {
+        int n = width * height, iter;
+        FLT diag = 2 / (dx * dx) + 2 / (dy * dy);
+
+        FLT* r = calloc(n, sizeof(FLT));
+        FLT* p = calloc(n, sizeof(FLT));
+        FLT* q = calloc(n, sizeof(FLT));
+        FLT* z = precondition ? calloc(n, sizeof(FLT)) : r;
+        if(r == NULL || p == NULL || q == NULL || z == NULL) {
+            if(precondition)
+                free(z);
+            free(r);
+            free(p);
+            free(q);
+            return -1;
+        }
+
+        /* initial residual, r = -L U */
+        CG_EXCHANGE(U, context);
+        cg_apply(U, r, width, dx, height, dy);
+        SCAL(n, -1, r);
+
+        FLT error = CG_MAX(cg_max(r, n), context) / diag, rz, rz_old = 1, alpha, beta;
+
+        for(iter=0; iter < max_iter && error >= threshold; iter++) {
+            if(precondition) {
+                #pragma omp parallel for simd
+                for(int i=0; i < n; i++)
+                    z[i] = r[i] / diag;
+            }
+
+            rz = CG_SUM(DOT(n, r, z), context);
+
+            /* new direction, p = z + beta * p */
+            beta = (iter == 0) ? 0 : rz / rz_old;
+            SCAL(n, beta, p);
+            AXPY(n, 1, z, p);
+
+            CG_EXCHANGE(p, context);
+            cg_apply(p, q, width, dx, height, dy);
+            alpha = rz / CG_SUM(DOT(n, p, q), context);
+
+            AXPY(n, alpha, p, U);
+            AXPY(n, -alpha, q, r);
+
+            rz_old = rz;
+            error = CG_MAX(cg_max(r, n), context) / diag;
+        }
+
+        if(CG_ROOT(context))
+            printf("final error=%f\n", error);
+
+        if(precondition)
+            free(z);
+        free(r);
+        free(p);
+        free(q);
+
+        return iter;
+    }
+}
+
+#endif // CG_H
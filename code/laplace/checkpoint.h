@@ -0,0 +1,134 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+/* Periodic checkpoints of the values (in the format of `field.h`), so that a solve can be restarted where it was (see `field_load()`).
+ *
+ * A checkpoint is written in two steps:
+ * 1. the values are copied (in parallel) in a new file, mapped in memory, next to the checkpoint (`path` with a `.tmp` suffix),
+ * 2. a thread writes that file to disk (with `msync()`), then renames it to `path`, while the iterations continue.
+ * Thus, `path` always contains a complete checkpoint, even if the job is killed while one is being written.
+ * If a checkpoint is still being written when the next one is due, the iterations wait for it.
+ *
+ * Requires `common.h` and `field.h`.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+typedef struct Checkpoint_ {
+    char* path;
+    char* tmp_path;
+    int period; // number of iterations between two checkpoints
+    int done; // number of iterations performed before the solver was started (when restarting)
+    int next; // (relative to `done`)
+
+    /* checkpoint being written */
+    int pending;
+    pthread_t thread;
+    void* map;
+    FieldHeader header;
+} Checkpoint;
+
+/* Create a checkpoint context, which writes to `path` every `period` iterations, for a solver which starts after `done` iterations.
+ */
+Checkpoint* checkpoint_new(const char* path, int period, int done) {
+    Checkpoint* checkpoint = malloc(sizeof(Checkpoint));
+    if(checkpoint == NULL)
+        return NULL;
+
+    checkpoint->path = strdup(path);
+    checkpoint->tmp_path = malloc(strlen(path) + 5);
+    if(checkpoint->path == NULL || checkpoint->tmp_path == NULL) {
+        free(checkpoint->path);
+        free(checkpoint->tmp_path);
+        free(checkpoint);
+        return NULL;
+    }
+
+    sprintf(checkpoint->tmp_path, "%s.tmp", path);
+    checkpoint->period = period;
+    checkpoint->done = done;
+    checkpoint->next = period;
+    checkpoint->pending = 0;
+
+    return checkpoint;
+}
+
+/* (thread) write the mapped file to disk, then replace the previous checkpoint with it.
+ */
+void* checkpoint_write(void* arg) {
+    Checkpoint* checkpoint = arg;
+
+    if(msync(checkpoint->map, FIELD_SIZE(&checkpoint->header), MS_SYNC) != 0 || rename(checkpoint->tmp_path, checkpoint->path) != 0)
+        printf("error while writing checkpoint %s\n", checkpoint->path);
+
+    field_close(checkpoint->map, &checkpoint->header);
+    return NULL;
+}
+
+/* Wait until the checkpoint being written (if any) is on disk.
+ */
+void checkpoint_wait(Checkpoint* checkpoint) {
+    if(checkpoint->pending) {
+        pthread_join(checkpoint->thread, NULL);
+        checkpoint->pending = 0;
+    }
+}
+
+/* Start writing a checkpoint of `U` (`width x height` values of `value_size` bytes), after `iter` iterations (of the solver) with a maximal change of `error`.
+ * Returns 0 on success, -1 on error.
+ */
+int checkpoint_save(Checkpoint* checkpoint, void* U, size_t value_size, unsigned int width, unsigned int height, int iter, double error) {
+    checkpoint_wait(checkpoint);
+
+    FieldHeader header = {.value_size = value_size, .width = width, .height = height, .iterations = checkpoint->done + iter, .error = error};
+    checkpoint->map = field_create(checkpoint->tmp_path, &header);
+    if(checkpoint->map == NULL) {
+        printf("error while creating checkpoint %s\n", checkpoint->tmp_path);
+        return -1;
+    }
+
+    checkpoint->header = header;
+
+    /* the copy is parallel (the pages of the file are written by all the threads) */
+    char* source = U;
+    char* destination = FIELD_VALUES(checkpoint->map, &header);
+    size_t size = (size_t) width * height * value_size, chunk = 1 << 20;
+
+    #pragma omp parallel for schedule(static)
+    for(size_t start=0; start < size; start += chunk)
+        memcpy(destination + start, source + start, (start + chunk < size) ? chunk : size - start);
+
+    if(pthread_create(&checkpoint->thread, NULL, checkpoint_write, checkpoint) != 0) {
+        checkpoint_write(checkpoint);
+        return 0;
+    }
+
+    checkpoint->pending = 1;
+    return 0;
+}
+
+/* Save a checkpoint if one is due after `iter` iterations (see `checkpoint_save()`).
+ * Nothing happens if `checkpoint` is NULL.
+ */
+void checkpoint_update(Checkpoint* checkpoint, void* U, size_t value_size, unsigned int width, unsigned int height, int iter, double error) {
+    if(checkpoint != NULL && iter >= checkpoint->next) {
+        checkpoint_save(checkpoint, U, value_size, width, height, iter, error);
+        checkpoint->next = iter + checkpoint->period;
+    }
+}
+
+/* Wait for the last checkpoint, and free the context.
+ */
+void checkpoint_delete(Checkpoint* checkpoint) {
+    if(checkpoint != NULL) {
+        checkpoint_wait(checkpoint);
+        free(checkpoint->path);
+        free(checkpoint->tmp_path);
+        free(checkpoint);
+    }
+}
+
+#endif // CHECKPOINT_H
@@ -1,7 +1,11 @@
 #ifndef COMMON_H
 #define COMMON_H
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "../timer.h"
+#include "image_ppm.h"
 
 #define DEFAULT_NITER 10000
 #define DEFAULT_THRESHOLD 1e-6
@@ -22,6 +26,45 @@ enum {
     RIGHT
 };
 
+/* Solvers (`-m xx`), the names are given in the same order in `SOLVERS`
+ */
+enum {
+    JACOBI,
+    SOR,
+    MULTIGRID,
+    DIRECT,
+    CONJUGATE_GRADIENT
+};
+
+const char* SOLVERS[] = {"jacobi", "sor", "mg", "dst", "cg", NULL};
+
+/* Precisions (`-p xx`), the names are given in the same order in `PRECISIONS`
+ */
+enum {
+    SINGLE,
+    DOUBLE,
+    MIXED // iterative refinement: sweeps in single precision, residuals in double precision
+};
+
+const char* PRECISIONS[] = {"single", "double", "mixed", NULL};
+
+/* Get the position of `name` in `names` (terminated by `NULL`), or -1 if it is not there.
+ */
+int get_choice(const char* names[], const char* name) {
+    for(int i=0; names[i] != NULL; i++) {
+        if(strcmp(names[i], name) == 0)
+            return i;
+    }
+
+    return -1;
+}
+
+/* Get the solver corresponding to `name`, or -1 if there is none.
+ */
+int get_solver(const char* name) {
+    return get_choice(SOLVERS, name);
+}
+
 int get_arguments(int argc, char* argv[], unsigned int* n_iter, FLT* threshold, char** input, char** output) {
     *n_iter = DEFAULT_NITER;
     *threshold = DEFAULT_THRESHOLD;
@@ -66,4 +109,161 @@ int get_arguments(int argc, char* argv[], unsigned int* n_iter, FLT* threshold,
     return 0;
 }
 
+/* Get the value of the boundary `side` of the input image (see `README.md`) at the point `j` of that side, which has `n` points.
+ * The row of pixels is resampled (linearly interpolated) when it does not have `n` pixels, so that the grid is independent of the size of the image.
+ */
+FLT boundary_value(Image* in, int side, unsigned int j, unsigned int n) {
+    unsigned char* pixels = &in->pixels[3 * side * in->width];
+    double position = (n > 1) ? (double) j * (in->width - 1) / (n - 1) : 0;
+    unsigned int i = (position < in->width - 1) ? (unsigned int) position : in->width - 1;
+    FLT fraction = position - i;
+
+    FLT left = (FLT) (pixels[3 * i + 0] - pixels[3 * i + 2]) / 255;
+    if(fraction == 0)
+        return left;
+
+    FLT right = (FLT) (pixels[3 * (i + 1) + 0] - pixels[3 * (i + 1) + 2]) / 255;
+    return left + fraction * (right - left);
+}
+
+/* Set the first and last row/column of `values` (a `width x height` grid) to the boundary conditions given by the input image.
+ */
+void fill_boundaries(Image* in, FLT* values, unsigned int width, unsigned int height) {
+    for (int j=0; j < width; j++)  {
+        values[0 * width + j] = boundary_value(in, TOP, j, width);
+        values[(height-1) * width + j] = boundary_value(in, BOTTOM, j, width);
+    }
+
+    for (int j=0; j < height; j++)  {
+        values[j * width + 0] = boundary_value(in, LEFT, j, height);
+        values[j * width + (width-1)] = boundary_value(in, RIGHT, j, height);
+    }
+}
+
+/* Get the size of the grid, with `-W xx` (the width of the input image by default) and `-H yy` (the width by default).
+ * Returns 0 on success, -1 if the size is invalid (there should be at least 3 points in each direction).
+ */
+int get_grid_size(int argc, char* argv[], Image* in, unsigned int* width, unsigned int* height) {
+    *width = in->width;
+
+    for (int i=1; i < argc; i++) {
+        if(strcmp(argv[i], "-W") == 0)
+            *width = ((i+1) < argc && atoi(argv[i + 1]) > 0) ? atoi(argv[i + 1]) : 0;
+    }
+
+    *height = *width;
+
+    for (int i=1; i < argc; i++) {
+        if(strcmp(argv[i], "-H") == 0)
+            *height = ((i+1) < argc && atoi(argv[i + 1]) > 0) ? atoi(argv[i + 1]) : 0;
+    }
+
+    return (*width < 3 || *height < 3) ? -1 : 0;
+}
+
+/* Check if `flag` (e.g., `-a`) is present in the command line.
+ */
+int get_flag(int argc, char* argv[], const char* flag) {
+    for (int i=1; i < argc; i++) {
+        if(strcmp(argv[i], flag) == 0)
+            return 1;
+    }
+
+    return 0;
+}
+
+/* Get the value which follows `option` (e.g., `-m xx`) in the command line, or `fallback` if the option is not present.
+ * Returns 0 if the value was read (or if the option is not provided),
+ * Returns -1 if there is nothing after the option.
+ */
+int get_option(int argc, char* argv[], const char* option, char** value, char* fallback) {
+    *value = fallback;
+
+    for (int i=1; i < argc; i++) {
+        if(strcmp(argv[i], option) == 0) {
+            if((i+1) == argc) // option, but nothing!
+                return -1;
+            *value = argv[i + 1];
+        }
+    }
+
+    return 0;
+}
+
+#define OUTPUT_CHUNK (1 << 22) // size (in bytes) of the chunks of the output image
+#define OUTPUT_ALIGNMENT 4096
+
+/* Write `values` in the PPM image at `path`: red is used for the positive values, and blue for the negative ones (scaled by the maximal absolute value of each).
+ * The range of the values is found in a single (parallel) pass.
+ * Then, the image is encoded by chunks of rows (of about `OUTPUT_CHUNK` bytes), in parallel, while the previous chunk is written by one of the threads.
+ * Returns 0 on success, -1 if the file cannot be opened, and -2 if it cannot be written.
+ */
+int write_output(FLT* values, unsigned int width, unsigned int height, const char* path) {
+    FLT max_positive = .0f, min_negative = .0f;
+    size_t n = (size_t) width * height;
+
+    #pragma omp parallel for reduction(min:min_negative) reduction(max:max_positive)
+    for(size_t i=0; i < n; i++) {
+        min_negative = (values[i] < min_negative) ? values[i] : min_negative;
+        max_positive = (values[i] > max_positive) ? values[i] : max_positive;
+    }
+
+    printf("min_negative = %.3f, max_positive = %.3f\n", min_negative, max_positive);
+
+    FILE* output = fopen(path, "w");
+    if(output == NULL)
+        return -1;
+
+    fprintf(output, "P6 %u %u %u\n", width, height, 255);
+
+    /* two buffers: one is written while the other is encoded */
+    unsigned int rows = (OUTPUT_CHUNK / (3 * width) > 0) ? OUTPUT_CHUNK / (3 * width) : 1;
+    size_t buffer_size = ((size_t) 3 * width * rows + OUTPUT_ALIGNMENT - 1) / OUTPUT_ALIGNMENT * OUTPUT_ALIGNMENT;
+    unsigned char* buffers[2] = {aligned_alloc(OUTPUT_ALIGNMENT, buffer_size), aligned_alloc(OUTPUT_ALIGNMENT, buffer_size)};
+    if(buffers[0] == NULL || buffers[1] == NULL) {
+        free(buffers[0]);
+        free(buffers[1]);
+        fclose(output);
+        return -2;
+    }
+
+    int status = 0;
+    for(unsigned int start=0, chunk=0; start < height + rows; start += rows, chunk++) { // (one more step, to write the last chunk)
+        unsigned char* current = buffers[chunk % 2];
+        unsigned char* previous = buffers[(chunk + 1) % 2];
+        unsigned int end = (start + rows < height) ? start + rows : height;
+
+        #pragma omp parallel
+        {
+            #pragma omp single nowait
+            {
+                if(start > 0) {
+                    size_t size = (size_t) 3 * width * (((start < height) ? start : height) - (start - rows));
+                    if(fwrite(previous, sizeof(unsigned char), size, output) != size)
+                        status = -2;
+                }
+            }
+
+            #pragma omp for schedule(dynamic, 16)
+            for(unsigned int y=start; y < end; y++) {
+                FLT* row = &values[(size_t) y * width];
+                unsigned char* pixels = &current[(size_t) 3 * width * (y - start)];
+                for(unsigned int x=0; x < width; x++) {
+                    FLT val = row[x];
+                    pixels[3 * x + 0] = (val >= .0f && max_positive > .0f) ? (unsigned char) (val / max_positive * 255) : 0;
+                    pixels[3 * x + 1] = 0;
+                    pixels[3 * x + 2] = (val < .0f) ? (unsigned char) (val / min_negative * 255) : 0;
+                }
+            }
+        }
+    }
+
+    free(buffers[0]);
+    free(buffers[1]);
+    if(fclose(output) != 0)
+        status = -2;
+
+    return status;
+}
+
 #endif // COMMON_H
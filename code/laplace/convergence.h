@@ -0,0 +1,119 @@
+#ifndef CONVERGENCE_H
+#define CONVERGENCE_H
+
+/* Convergence checks of the jacobi and SOR solvers.
+ *
+ * By default, the solvers stop as soon as the maximal change of an iteration is below the threshold, which needs a reduction over all the threads at each iteration.
+ * A `Convergence` changes
+ * - the norm of the change (`-E xx`): `max` (default), `l2` (root mean square of the change over the interior points), or `relative` (maximal change, divided by the maximal absolute value of the grid),
+ * - how often it is computed (`-c k`): every `k` iterations only, the other ones having no reduction at all (so that the solver stops at most `k - 1` iterations after the threshold is reached).
+ * With `k > 1`, the checks of jacobi are also spaced out while the convergence is far away: the contraction rate per iteration is measured between the last two checks, which gives the number of iterations that remain before reaching the threshold (the change of jacobi decreases geometrically), and the next check is done after half of them, but no later than `k` iterations before the predicted crossing (or after `k` iterations, if that is more).
+ * The change of SOR does not decrease geometrically (the prediction overshoots), so SOR is checked every `k` iterations (its change also oscillates a little, so that an iteration below the threshold between two checks may be missed).
+ * Thus, the number of checks of jacobi only grows with the logarithm of the number of iterations, and the iterations close to the threshold are checked every `k` iterations.
+ * The last iteration (`max_iter`) is always checked.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <math.h>
+
+#define CONVERGENCE_SAFETY .5 // fraction of the predicted iterations performed before the next check
+
+/* Norms (`-E xx`), the names are given in the same order in `NORMS` */
+enum {
+    NORM_MAX,
+    NORM_L2,
+    NORM_RELATIVE
+};
+
+const char* NORMS[] = {"max", "l2", "relative", NULL};
+
+typedef struct Convergence_ {
+    int norm;
+    int period; // (minimal) number of iterations between two checks
+    int predict; // 1 to space out the checks while the convergence is far away
+
+    /* last check */
+    int next; // iteration of the next check
+    int iter;
+    double error;
+
+    int checks; // number of checks
+} Convergence;
+
+/* Create a convergence check with `norm`, every `period` iterations (at least).
+ * Returns NULL on error.
+ */
+Convergence* convergence_new(int norm, int period) {
+    Convergence* convergence = malloc(sizeof(Convergence));
+    if(convergence == NULL)
+        return NULL;
+
+    convergence->norm = norm;
+    convergence->period = (period > 0) ? period : 1;
+    return convergence;
+}
+
+/* Start checking a solver, with the checks spaced out while the convergence is far away if `predict` is 1 (for jacobi only, see above).
+ * If `convergence` is NULL (in all the functions), the maximal change is checked at each iteration.
+ */
+void convergence_start(Convergence* convergence, int predict) {
+    if(convergence != NULL) {
+        convergence->predict = predict;
+        convergence->next = convergence->period;
+        convergence->iter = 0;
+        convergence->error = NAN;
+        convergence->checks = 0;
+    }
+}
+
+/* Get the norm of the checks.
+ */
+int convergence_norm(Convergence* convergence) {
+    return (convergence != NULL) ? convergence->norm : NORM_MAX;
+}
+
+/* Check if the change of iteration `iter` (out of `max_iter`) should be computed.
+ */
+int convergence_due(Convergence* convergence, int iter, int max_iter) {
+    return convergence == NULL || iter >= convergence->next || iter >= max_iter;
+}
+
+/* Get the norm of the change, out of its maximal absolute value (`change`), the sum of its squares (`squares`), and the maximal absolute value of the grid (`magnitude`), over `n` points.
+ * (`squares` and `magnitude` are only needed by the corresponding norm)
+ */
+double convergence_error(Convergence* convergence, double change, double squares, double magnitude, double n) {
+    switch(convergence_norm(convergence)) {
+        case NORM_L2:
+            return sqrt(squares / n);
+        case NORM_RELATIVE:
+            return (magnitude > 0) ? change / magnitude : change;
+        default:
+            return change;
+    }
+}
+
+/* Record the check of iteration `iter`, which gave `error`, and schedule the next one (see above).
+ */
+void convergence_update(Convergence* convergence, int iter, double error, double threshold) {
+    if(convergence == NULL)
+        return;
+
+    int gap = convergence->period;
+    if(convergence->predict && convergence->period > 1 && convergence->iter > 0 && error >= threshold && error > 0 && error < convergence->error) {
+        double rate = log(error / convergence->error) / (iter - convergence->iter); // (logarithm of the contraction per iteration)
+        double remaining = log(threshold / error) / rate;
+        double predicted = fmin(CONVERGENCE_SAFETY * remaining, remaining - convergence->period); // (never more than `period` iterations past the predicted crossing)
+        if(predicted > gap)
+            gap = (predicted < INT_MAX / 2) ? (int) predicted : INT_MAX / 2;
+    }
+
+    convergence->checks++;
+    convergence->iter = iter;
+    convergence->error = error;
+    convergence->next = iter + gap;
+}
+
+#endif // CONVERGENCE_H
@@ -0,0 +1,319 @@
+#ifndef DST_H
+#define DST_H
+
+/* Direct solver for the Laplace equation (Dirichlet boundary conditions), using the discrete sine transform (DST).
+ *
+ * The boundary conditions are moved to the right-hand side, so that the equation becomes `L u = b` on the interior points, with `L` the 5-point operator and homogeneous boundary conditions.
+ * The eigenvectors of `L` are then sines, so `L` is diagonalized by a DST (type I) in both directions.
+ * In practice, a DST along the rows is enough: it leaves one independent tridiagonal system per sine mode along the columns, solved in `O(N)`,
+ * so that the whole solve takes `O(N^2 log N)` operations.
+ * The DSTs are computed out of complex FFTs (radix-2, or Bluestein's algorithm for the other sizes).
+ *
+ * Requires `common.h` (for `FLT` and `ffmax()`).
+ */
+
+#include <complex.h>
+#include <math.h>
+#include <stdlib.h>
+
+#undef I // `_Complex_I` is used instead, so that `I` remains available for variables
+
+typedef struct DST_ {
+    /* Plan for a DST-I of size `n`: `X_k = sum_{j=1}^{n} x_j sin(pi j k / (n + 1))`, for `k=1..n`.
+     *
+     * It is computed with a FFT of size `m = 2(n+1)` of the odd extension of `x`.
+     * If `m` is not a power of 2, Bluestein's algorithm turns this FFT into a convolution, computed by FFTs of size `p >= 2m - 1` (a power of 2).
+     */
+    unsigned int n, m, p;
+    double complex* twiddles; // `exp(-2 i pi k / p)`, for `k < p/2`
+    double complex* chirp; // `exp(-i pi k^2 / m)`, for `k < m` (Bluestein only)
+    double complex* chirp_fft; // FFT of the convolution kernel (Bluestein only)
+} DST;
+
+/* Complex multiplication (`a * b` calls a library function which handles the infinities and NaN, and is way slower).
+ */
+double complex cmul(double complex a, double complex b) {
+    return CMPLX(creal(a) * creal(b) - cimag(a) * cimag(b), creal(a) * cimag(b) + cimag(a) * creal(b));
+}
+
+/* In place radix-2 FFT of `data` (of size `p`, a power of 2).
+ * If `inverse` is set, compute the inverse transform (without the `1/p` normalization).
+ */
+void fft(double complex* data, unsigned int p, double complex* twiddles, int inverse) {
+    /* bit reversal */
+    for(unsigned int i=1, j=0; i < p; i++) {
+        unsigned int bit = p >> 1;
+        for(; j & bit; bit >>= 1)
+            j ^= bit;
+        j ^= bit;
+
+        if(i < j) {
+            double complex swap = data[i];
+            data[i] = data[j];
+            data[j] = swap;
+        }
+    }
+
+    /* butterflies */
+    for(unsigned int len=2; len <= p; len <<= 1) {
+        unsigned int half = len >> 1, step = p / len;
+        for(unsigned int k=0; k < half; k++) {
+            double complex w = inverse ? conj(twiddles[k * step]) : twiddles[k * step];
+            for(unsigned int i=0; i < p; i += len) {
+                double complex t = cmul(w, data[i + k + half]);
+                data[i + k + half] = data[i + k] - t;
+                data[i + k] += t;
+            }
+        }
+    }
+}
+
+void dst_delete(DST* dst) {
+    if(dst != NULL) {
+        free(dst->twiddles);
+        free(dst->chirp);
+        free(dst->chirp_fft);
+        free(dst);
+    }
+}
+
+/* Create a plan for a DST-I of size `n`.
+ * Returns NULL on error.
+ */
+DST* dst_new(unsigned int n) {
+    DST* dst = calloc(1, sizeof(DST));
+    if(dst == NULL)
+        return NULL;
+
+    dst->n = n;
+    dst->m = 2 * (n + 1);
+
+    if((dst->m & (dst->m - 1)) == 0)
+        dst->p = dst->m;
+    else
+        for(dst->p = 1; dst->p < 2 * dst->m - 1; dst->p <<= 1);
+
+    dst->twiddles = malloc(dst->p / 2 * sizeof(double complex));
+    if(dst->twiddles == NULL) {
+        dst_delete(dst);
+        return NULL;
+    }
+
+    for(unsigned int k=0; k < dst->p / 2; k++)
+        dst->twiddles[k] = cexp(-2 * _Complex_I * M_PI * k / dst->p);
+
+    if(dst->p != dst->m) {
+        dst->chirp = malloc(dst->m * sizeof(double complex));
+        dst->chirp_fft = calloc(dst->p, sizeof(double complex));
+        if(dst->chirp == NULL || dst->chirp_fft == NULL) {
+            dst_delete(dst);
+            return NULL;
+        }
+
+        for(unsigned int k=0; k < dst->m; k++) // k^2 is taken modulo 2m, to keep the precision of the angle
+            dst->chirp[k] = cexp(-_Complex_I * M_PI * (double) ((unsigned long long) k * k % (2 * dst->m)) / dst->m);
+
+        dst->chirp_fft[0] = conj(dst->chirp[0]);
+        for(unsigned int k=1; k < dst->m; k++) {
+            dst->chirp_fft[k] = conj(dst->chirp[k]);
+            dst->chirp_fft[dst->p - k] = conj(dst->chirp[k]);
+        }
+
+        fft(dst->chirp_fft, dst->p, dst->twiddles, 0);
+    }
+
+    return dst;
+}
+
+/* Compute the DST-I of `x1` and `x2` (`n` elements each, separated by `stride`), and store them in place.
+ * Since the input is real, the two transforms are computed at once, by using `x1 + i x2` as input of the FFT.
+ * work: array of `p` elements
+ */
+void dst_apply(DST* dst, double* x1, double* x2, unsigned int stride, double complex* work) {
+    unsigned int n = dst->n, m = dst->m, p = dst->p;
+
+    /* odd extension */
+    work[0] = 0;
+    work[n + 1] = 0;
+    for(unsigned int j=1; j <= n; j++) {
+        work[j] = CMPLX(x1[(j - 1) * stride], x2[(j - 1) * stride]);
+        work[m - j] = -work[j];
+    }
+
+    if(p == m)
+        fft(work, p, dst->twiddles, 0);
+    else {
+        /* Bluestein: the FFT is a convolution with the chirp */
+        for(unsigned int k=0; k < m; k++)
+            work[k] = cmul(work[k], dst->chirp[k]);
+        for(unsigned int k=m; k < p; k++)
+            work[k] = 0;
+
+        fft(work, p, dst->twiddles, 0);
+        for(unsigned int k=0; k < p; k++)
+            work[k] = cmul(work[k], dst->chirp_fft[k]);
+        fft(work, p, dst->twiddles, 1);
+
+        for(unsigned int k=1; k <= n; k++)
+            work[k] = cmul(work[k], dst->chirp[k]) / p;
+    }
+
+    /* the FFT of the odd extension of x is `-2i DST(x)` */
+    for(unsigned int k=1; k <= n; k++) {
+        x1[(k - 1) * stride] = -cimag(work[k]) / 2;
+        x2[(k - 1) * stride] = creal(work[k]) / 2;
+    }
+}
+
+/* Apply the DST-I on each row of the `nx x ny` array `b`, in parallel (two rows at a time, see `dst_apply()`).
+ * Returns -1 on error.
+ */
+int dst_rows(DST* dst, double* b, unsigned int nx, unsigned int ny) {
+    int error = 0;
+
+    #pragma omp parallel reduction(min:error)
+    {
+        double complex* work = malloc(dst->p * sizeof(double complex));
+        if(work == NULL)
+            error = -1;
+        else {
+            #pragma omp for schedule(static)
+            for(unsigned int y=0; y < ny; y += 2)
+                dst_apply(dst, &b[y * nx], &b[(y + (y + 1 < ny)) * nx], 1, work);
+        }
+
+        free(work);
+    }
+
+    return error;
+}
+
+#define DST_BLOCK 64 // number of columns (i.e., of tridiagonal systems) solved together
+
+/* Solve the tridiagonal systems `(eigen_x[k] + 2 cy) u_l - cy (u_{l-1} + u_{l+1}) = b_l` along each column `k` of the `nx x ny` array `b`, in place, with the Thomas algorithm.
+ * The columns are solved by blocks of `DST_BLOCK` (in parallel), so that `b` is read by chunks of rows and the inner loops are vectorized.
+ * Returns -1 on error.
+ */
+int tridiagonal_columns(double* b, unsigned int nx, unsigned int ny, double* eigen_x, double cy) {
+    int error = 0;
+
+    #pragma omp parallel reduction(min:error)
+    {
+        double* c = malloc(DST_BLOCK * ny * sizeof(double)); // modified upper diagonal
+        if(c == NULL)
+            error = -1;
+        else {
+            #pragma omp for schedule(static)
+            for(unsigned int k0=0; k0 < nx; k0 += DST_BLOCK) {
+                unsigned int block = (nx - k0 < DST_BLOCK) ? nx - k0 : DST_BLOCK;
+                double* d = &b[k0];
+
+                /* forward elimination */
+                #pragma omp simd
+                for(unsigned int k=0; k < block; k++) {
+                    double diag = eigen_x[k0 + k] + 2 * cy;
+                    c[k] = -cy / diag;
+                    d[k] /= diag;
+                }
+
+                for(unsigned int l=1; l < ny; l++) {
+                    #pragma omp simd
+                    for(unsigned int k=0; k < block; k++) {
+                        double diag = eigen_x[k0 + k] + 2 * cy + cy * c[(l - 1) * DST_BLOCK + k];
+                        c[l * DST_BLOCK + k] = -cy / diag;
+                        d[l * nx + k] = (d[l * nx + k] + cy * d[(l - 1) * nx + k]) / diag;
+                    }
+                }
+
+                /* back substitution */
+                for(int l=ny - 2; l >= 0; l--) {
+                    #pragma omp simd
+                    for(unsigned int k=0; k < block; k++)
+                        d[l * nx + k] -= c[l * DST_BLOCK + k] * d[(l + 1) * nx + k];
+                }
+            }
+        }
+
+        free(c);
+    }
+
+    return error;
+}
+
+/* Solve the Laplace equation directly, with DSTs.
+ * The first and last row/column are used to get the values for the Dirichlet (i.e., fixed value) boundary conditions.
+ * Rather than transforming in both directions (which requires twice as much DSTs), the rows are transformed, which leaves one independent tridiagonal system per sine mode along the columns.
+ * Returns 1 (the number of "iterations"), or -1 on error.
+ * U: function
+ * f: source term of the Poisson equation `∇²u = f` (a `width x height` grid, see `source.h`), or NULL for the Laplace equation
+ */
+int laplace_dst(FLT* U, unsigned int width, FLT dx, unsigned int height, FLT dy, FLT* f) {
+    if(U != NULL) {
+        unsigned int nx = width - 2, ny = height - 2;
+        double cx = 1 / ((double) dx * dx), cy = 1 / ((double) dy * dy);
+
+        double* b = malloc(nx * ny * sizeof(double));
+        double* eigen_x = malloc(nx * sizeof(double));
+        DST* dst = dst_new(nx);
+
+        if(b == NULL || eigen_x == NULL || dst == NULL) {
+            dst_delete(dst);
+            free(eigen_x);
+            free(b);
+            return -1;
+        }
+
+        for(unsigned int k=0; k < nx; k++)
+            eigen_x[k] = cx * (2 - 2 * cos(M_PI * (k + 1) / (nx + 1)));
+
+        /* right-hand side: source term, and contribution of the boundary conditions */
+        #pragma omp parallel for
+        for(unsigned int y=0; y < ny; y++) {
+            for(unsigned int x=0; x < nx; x++) {
+                double value = (f != NULL) ? -f[(y + 1) * width + x + 1] : .0;
+                if(x == 0)
+                    value += cx * U[(y + 1) * width + 0];
+                if(x == nx - 1)
+                    value += cx * U[(y + 1) * width + width - 1];
+                if(y == 0)
+                    value += cy * U[0 * width + x + 1];
+                if(y == ny - 1)
+                    value += cy * U[(height - 1) * width + x + 1];
+                b[y * nx + x] = value;
+            }
+        }
+
+        /* transform the rows, solve along the columns, transform back */
+        int error = dst_rows(dst, b, nx, ny);
+        error = error || tridiagonal_columns(b, nx, ny, eigen_x, cy);
+        error = error || dst_rows(dst, b, nx, ny);
+
+        double scale = 2. / (nx + 1);
+
+        #pragma omp parallel for
+        for(unsigned int y=0; y < ny; y++) {
+            for(unsigned int x=0; x < nx; x++)
+                U[(y + 1) * width + x + 1] = (FLT) (scale * b[y * nx + x]);
+        }
+
+        /* check: the change that a jacobi iteration would make */
+        FLT change = .0f;
+
+        #pragma omp parallel for reduction(max:change)
+        for(int y=1; y < (height - 1); y++) {
+            for(int x=1; x < (width - 1); x++) {
+                change = ffmax(change, fabs((dy * dy * ( U[(y) * width + x+1] + U[(y) * width + x-1] ) +  dx * dx * ( U[(y+1) * width + x] + U[(y-1) * width + x] ) - ((f != NULL) ? dx * dx * dy * dy * f[(y) * width + x] : 0)) / (2 * dx * dx + 2 * dy * dy) - U[(y) * width + x]));
+            }
+        }
+
+        printf("final error=%f\n", change);
+
+        dst_delete(dst);
+        free(eigen_x);
+        free(b);
+
+        return error ? -1 : 1;
+    }
+}
+
+#endif // DST_H
@@ -0,0 +1,118 @@
+#ifndef FIELD_H
+#define FIELD_H
+
+/* Binary files containing the values of the grid (for checkpoints and raw outputs, with `-C` and `-O`).
+ *
+ * The file starts with a header (`FieldHeader`), followed (at `offset`, which is a multiple of the page size) by the `width x height` values, as a raw array of float or double.
+ * The files are accessed through `mmap()`, so that the values can be used in place, without parsing.
+ * For instance, with numpy: `numpy.memmap("field.bin", dtype=numpy.float64, offset=4096, shape=(height, width))`.
+ *
+ * Requires `common.h` (for `FLT`).
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#define FIELD_MAGIC "LAPLACE" // (with the final '\0', 8 bytes)
+#define FIELD_OFFSET 4096 // the values start at a page boundary, so that they can be mapped on their own
+
+typedef struct FieldHeader_ {
+    char magic[8];
+    uint32_t value_size; // size of a value: 4 (float) or 8 (double)
+    uint32_t width, height;
+    uint32_t offset; // position of the values in the file
+    int64_t iterations; // number of iterations performed to get the values
+    double error; // maximal change during the last iteration (NaN if unknown)
+} FieldHeader;
+
+/* Values of a mapped file */
+#define FIELD_VALUES(map, header) ((void*) ((char*) (map) + (header)->offset))
+
+/* Size of a file */
+#define FIELD_SIZE(header) ((size_t) (header)->offset + (size_t) (header)->width * (header)->height * (header)->value_size)
+
+/* Create (or replace) the file at `path`, large enough for `header`, and map it.
+ * The header is written (with the magic number and offset).
+ * Returns the mapping (see `FIELD_VALUES()` for the values), or NULL on error.
+ */
+void* field_create(const char* path, FieldHeader* header) {
+    memcpy(header->magic, FIELD_MAGIC, sizeof(header->magic));
+    header->offset = FIELD_OFFSET;
+
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0)
+        return NULL;
+
+    if(ftruncate(fd, FIELD_SIZE(header)) != 0) {
+        close(fd);
+        return NULL;
+    }
+
+    void* map = mmap(NULL, FIELD_SIZE(header), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd); // (the mapping remains)
+    if(map == MAP_FAILED)
+        return NULL;
+
+    memcpy(map, header, sizeof(FieldHeader));
+    return map;
+}
+
+/* Map the file at `path` (read only), and copy its header in `header`.
+ * Returns the mapping, or NULL if the file cannot be read or is not a valid field.
+ */
+void* field_open(const char* path, FieldHeader* header) {
+    int fd = open(path, O_RDONLY);
+    if(fd < 0)
+        return NULL;
+
+    off_t size = lseek(fd, 0, SEEK_END);
+    if(size < (off_t) sizeof(FieldHeader) || pread(fd, header, sizeof(FieldHeader), 0) != sizeof(FieldHeader)
+            || memcmp(header->magic, FIELD_MAGIC, sizeof(header->magic)) != 0 || (header->value_size != sizeof(float) && header->value_size != sizeof(double))
+            || size < (off_t) FIELD_SIZE(header)) {
+        close(fd);
+        return NULL;
+    }
+
+    void* map = mmap(NULL, FIELD_SIZE(header), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    return (map == MAP_FAILED) ? NULL : map;
+}
+
+/* Unmap a file obtained with `field_create()` or `field_open()`.
+ */
+void field_close(void* map, FieldHeader* header) {
+    munmap(map, FIELD_SIZE(header));
+}
+
+/* Read the file at `path` in `values` (which should be `width x height`), converting the values to `FLT` if needed.
+ * On success, its header is copied in `header`.
+ * Returns 0 on success, -1 if the file cannot be read, and -2 if its size does not match.
+ */
+int field_load(const char* path, FLT* values, unsigned int width, unsigned int height, FieldHeader* header) {
+    void* map = field_open(path, header);
+    if(map == NULL)
+        return -1;
+
+    if(header->width != width || header->height != height) {
+        field_close(map, header);
+        return -2;
+    }
+
+    size_t n = (size_t) width * height;
+    if(header->value_size == sizeof(FLT))
+        memcpy(values, FIELD_VALUES(map, header), n * sizeof(FLT));
+    else {
+        #pragma omp parallel for
+        for(size_t i=0; i < n; i++)
+            values[i] = (header->value_size == sizeof(float)) ? (FLT) ((float*) FIELD_VALUES(map, header))[i] : (FLT) ((double*) FIELD_VALUES(map, header))[i];
+    }
+
+    field_close(map, header);
+    return 0;
+}
+
+#endif // FIELD_H
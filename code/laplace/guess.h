@@ -0,0 +1,135 @@
+#ifndef GUESS_H
+#define GUESS_H
+
+/* Initial guesses (warm starts) for the interior of the grid, since starting from zero means that most of the (jacobi) iterations are spent diffusing the boundary conditions inward.
+ * - `coons`: transfinite (bilinearly blended Coons patch) interpolation of the four boundaries, which is exact for bilinear functions,
+ * - `coarse`: direct solve on a grid `GUESS_COARSENING` times coarser (with the source term restricted to that grid, for the Poisson equation), bilinearly interpolated on the grid,
+ * - a file (in the format of `field.h`, e.g., the output of a previous run with `-O`), of any size, bilinearly interpolated on the grid.
+ * The boundaries are never modified.
+ *
+ * Requires `common.h`, `field.h`, `multigrid.h` (for `mg_prolongate()` and `mg_restrict()`) and `dst.h`.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define GUESS_COARSENING 4
+
+/* Guesses (`-g xx`), the names are given in the same order in `GUESSES` (anything else is a file) */
+enum {
+    GUESS_ZERO,
+    GUESS_COONS,
+    GUESS_COARSE,
+    GUESS_FILE
+};
+
+const char* GUESSES[] = {"zero", "coons", "coarse", NULL};
+
+/* Get the maximal change that a jacobi iteration would make on `U`, with the term `rhs` of the source (see `source_rhs()`), or NULL for the Laplace equation.
+ */
+FLT guess_error(FLT* U, unsigned int width, FLT dx, unsigned int height, FLT dy, FLT* rhs) {
+    FLT error = .0f;
+
+    #pragma omp parallel for reduction(max:error)
+    for(int y=1; y < (height - 1); y++) {
+        for(int x=1; x < (width - 1); x++) {
+            FLT value = (dy * dy * (U[y * width + x + 1] + U[y * width + x - 1]) + dx * dx * (U[(y + 1) * width + x] + U[(y - 1) * width + x])) / (2 * dx * dx + 2 * dy * dy);
+            if(rhs != NULL)
+                value += rhs[y * width + x];
+            error = ffmax(error, fabs(value - U[y * width + x]));
+        }
+    }
+
+    return error;
+}
+
+/* Set the interior of `U` to the Coons patch of its boundaries:
+ * `U(s,t) = (1-t) top(s) + t bottom(s) + (1-s) left(t) + s right(t) - (bilinear interpolation of the corners)`, with `s` and `t` between 0 and 1.
+ */
+void guess_coons(FLT* U, unsigned int width, unsigned int height) {
+    FLT* top = U;
+    FLT* bottom = &U[(height - 1) * width];
+    FLT c00 = top[0], c10 = top[width - 1], c01 = bottom[0], c11 = bottom[width - 1];
+
+    #pragma omp parallel for
+    for(int y=1; y < (height - 1); y++) {
+        FLT t = (FLT) y / (height - 1), left = U[y * width], right = U[y * width + width - 1];
+        for(int x=1; x < (width - 1); x++) {
+            FLT s = (FLT) x / (width - 1);
+            U[y * width + x] = (1 - t) * top[x] + t * bottom[x] + (1 - s) * left + s * right
+                - ((1 - s) * (1 - t) * c00 + s * (1 - t) * c10 + (1 - s) * t * c01 + s * t * c11);
+        }
+    }
+}
+
+/* Linear interpolation of `n` points out of `m` points (separated by `stride`), from `source` to `destination`.
+ */
+void guess_edge(FLT* source, unsigned int m, unsigned int source_stride, FLT* destination, unsigned int n, unsigned int destination_stride) {
+    for(unsigned int j=0; j < n; j++) {
+        FLT position = (FLT) j * (m - 1) / (n - 1);
+        unsigned int i = (position < m - 1) ? (unsigned int) position : m - 2;
+        FLT t = position - i;
+        destination[j * destination_stride] = (1 - t) * source[i * source_stride] + t * source[(i + 1) * source_stride];
+    }
+}
+
+/* Set the interior of `U` to the solution on a grid `GUESS_COARSENING` times coarser (with the boundaries of `U`, and the source `f` restricted to that grid if it is not NULL, see `source.h`), computed with the direct solver.
+ * Returns 0 on success, -1 on error.
+ */
+int guess_coarse(FLT* U, unsigned int width, FLT dx, unsigned int height, FLT dy, FLT* f) {
+    unsigned int cw = (width - 1) / GUESS_COARSENING + 1, ch = (height - 1) / GUESS_COARSENING + 1;
+    cw = (cw < 3) ? 3 : cw;
+    ch = (ch < 3) ? 3 : ch;
+
+    FLT* coarse = calloc(cw * ch, sizeof(FLT));
+    FLT* coarse_f = (f != NULL) ? calloc(cw * ch, sizeof(FLT)) : NULL;
+    if(coarse == NULL || (f != NULL && coarse_f == NULL)) {
+        free(coarse);
+        free(coarse_f);
+        return -1;
+    }
+
+    if(f != NULL)
+        mg_restrict(f, width, height, coarse_f, cw, ch);
+
+    guess_edge(U, width, 1, coarse, cw, 1);
+    guess_edge(&U[(height - 1) * width], width, 1, &coarse[(ch - 1) * cw], cw, 1);
+    guess_edge(U, height, width, coarse, ch, cw);
+    guess_edge(&U[width - 1], height, width, &coarse[cw - 1], ch, cw);
+
+    printf("using a coarse grid of %dx%d for the initial guess\n", cw, ch);
+    int result = laplace_dst(coarse, cw, dx * (width - 1) / (cw - 1), ch, dy * (height - 1) / (ch - 1), coarse_f);
+    if(result >= 0)
+        mg_prolongate(coarse, cw, ch, U, width, height, 0);
+
+    free(coarse);
+    free(coarse_f);
+    return (result < 0) ? -1 : 0;
+}
+
+/* Set the interior of `U` to the values of the file at `path`, bilinearly interpolated if it does not have the same size.
+ * Returns 0 on success, -1 on error.
+ */
+int guess_file(FLT* U, unsigned int width, unsigned int height, const char* path) {
+    FieldHeader header;
+    void* map = field_open(path, &header);
+    if(map == NULL)
+        return -1;
+
+    field_close(map, &header); // (only the size was needed)
+    if(header.width < 2 || header.height < 2)
+        return -1;
+
+    FLT* values = malloc((size_t) header.width * header.height * sizeof(FLT));
+    if(values == NULL || field_load(path, values, header.width, header.height, &header) != 0) {
+        free(values);
+        return -1;
+    }
+
+    mg_prolongate(values, header.width, header.height, U, width, height, 0);
+    free(values);
+    return 0;
+}
+
+#endif // GUESS_H
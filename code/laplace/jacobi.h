@@ -0,0 +1,415 @@
+/* Jacobi (with and without temporal blocking) and red-black SOR solvers, for a given precision.
+ * This file has no include guard: it is included once per precision, after defining
+ * - `FLT`, the type of the values,
+ * - `NAME(name)`, which adds a suffix to the name of the functions (e.g., `laplace_float()`),
+ * - `G(x,y)` and `T(x,y)`, which access the current and next values.
+ *
+ * Requires `simd.h` (for `JACOBI_ROW()`), `placement.h` (for `grid_alloc()`), `checkpoint.h`, `telemetry.h` and `convergence.h`.
+ * The loops over the rows are `schedule(static)`, so that each thread works on the rows it placed (see `placement.h`).
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef TILE_WIDTH
+#define TILE_WIDTH 256
+#endif
+
+#ifndef TILE_HEIGHT
+#define TILE_HEIGHT 64
+#endif
+
+/* (`ffmax()` of `common.h` is in the default precision)
+ */
+__inline FLT NAME(ffmax)(FLT left, FLT right) {
+    return (left > right) ? left : right;
+}
+
+/* Add the squares of the change between `in` and `out` (`n` values) to `squares`, and the maximal absolute value of `out` to `magnitude` (for the norms of `convergence.h`).
+ */
+void NAME(row_norms)(FLT* out, FLT* in, int n, double* squares, FLT* magnitude) {
+    double sum = .0;
+    FLT largest = *magnitude;
+
+    #pragma omp simd reduction(+:sum) reduction(max:largest)
+    for(int x=0; x < n; x++) {
+        FLT change = out[x] - in[x];
+        sum += change * change;
+        largest = NAME(ffmax)(largest, fabs(out[x]));
+    }
+
+    *squares += sum;
+    *magnitude = largest;
+}
+
+/* Compute the Laplace equation until the maximal change is lower than `threshold` or the number of iteration exceed `max_iter`.
+ * The first and last row/column are used to get the values for the Dirichlet (i.e., fixed value) boundary conditions.
+ * The new values and the change are computed in a single pass (by the row kernel selected in `simd.h`), then the two buffers are swapped.
+ * With `convergence`, the change is only reduced over the threads (and compared to `threshold`) at the iterations it selects, in the norm it selects (see `convergence.h`).
+ * Returns the number of iterations, or -1 on error.
+ * U: function
+ * rhs: source term (see `source.h`), or NULL for the Laplace equation
+ * max_iter: maximal number of iteration
+ * threshold: minimal change
+ * checkpoint: where to save checkpoints (see `checkpoint.h`), or NULL
+ * telemetry: where to record the convergence (see `telemetry.h`), or NULL
+ * convergence: when and how to check the convergence (see `convergence.h`), or NULL for the maximal change at each iteration
+ */
+int NAME(laplace)(FLT* U, unsigned int width, FLT dx, unsigned int height, FLT dy, FLT* rhs, int max_iter, FLT threshold, Checkpoint* checkpoint, Telemetry* telemetry, Convergence* convergence) {
+    if(U != NULL) {
+        
+        FLT* values = U;
+        FLT* tmp = grid_alloc(width, height, sizeof(FLT));
+        if(tmp == NULL)
+            return -1;
+
+        /* both buffers hold the boundary conditions */
+        #pragma omp parallel for schedule(static)
+        for(int y=0; y < height; y++) {
+            for(int x=0; x < width; x++) {
+                T(x, y) = G(x, y);
+            }
+        }
+        
+        FLT cx = dy * dy / (2 * dx * dx + 2 * dy * dy), cy = dx * dx / (2 * dx * dx + 2 * dy * dy);
+        FLT error = .0f;
+        int iter, norm = convergence_norm(convergence);
+        telemetry_start(telemetry, width, height, (rhs != NULL ? 3 : 2) * sizeof(FLT), threshold); // (read `U` and `rhs`, write `tmp`)
+        convergence_start(convergence, 1);
+
+        for(iter=0; iter < max_iter; iter++) {
+            int check = convergence_due(convergence, iter + 1, max_iter);
+
+            if(check) {
+                FLT change = .0f, magnitude = .0f;
+                double squares = .0;
+
+                #pragma omp parallel for reduction(max:change,magnitude) reduction(+:squares) schedule(static)
+                for(int y=1; y < (height - 1); y++) {
+                    change = NAME(ffmax)(change, JACOBI_ROW(&T(1, y), &G(1, y), (rhs != NULL) ? &rhs[y * width + 1] : NULL, width, width - 2, cx, cy));
+                    if(norm != NORM_MAX)
+                        NAME(row_norms)(&T(1, y), &G(1, y), width - 2, &squares, &magnitude);
+                }
+
+                error = convergence_error(convergence, change, squares, magnitude, (double) (width - 2) * (height - 2));
+            } else {
+                /* (the change is not needed: no reduction) */
+                #pragma omp parallel for schedule(static)
+                for(int y=1; y < (height - 1); y++) {
+                    JACOBI_ROW(&T(1, y), &G(1, y), (rhs != NULL) ? &rhs[y * width + 1] : NULL, width, width - 2, cx, cy);
+                }
+            }
+
+            /* the new values become the current ones */
+            FLT* swap = U;
+            U = tmp;
+            tmp = swap;
+
+            checkpoint_update(checkpoint, U, sizeof(FLT), width, height, iter + 1, error);
+            if(!check)
+                continue;
+
+            telemetry_update(telemetry, iter + 1, error);
+            convergence_update(convergence, iter + 1, error, threshold);
+
+            if (error < threshold) {
+                iter++;
+                break;
+            }
+        }
+        
+        printf("final error=%f\n", error);
+        telemetry_summary(telemetry, iter, error);
+
+        /* the result must end up in the caller's buffer */
+        if(U != values) {
+            memcpy(values, U, width * height * sizeof(FLT));
+            tmp = U;
+        }
+
+        grid_free(tmp);
+        return iter;
+    }
+}
+
+/* Perform `steps` jacobi iterations on `U` by (overlapping) tiles of `TILE_WIDTH x TILE_HEIGHT` points, and store the result in `out`.
+ * Each tile is copied, together with a margin of `steps` points, in a buffer that fits in cache, where the iterations are performed.
+ * At each iteration, the part of the buffer that is computed shrinks by one point, so that the tile itself is exact after `steps` iterations.
+ * The maximal change of each iteration is stored in `errors`.
+ * Returns 0 on success, -1 if the buffers cannot be allocated.
+ * rhs: source term (see `source.h`), or NULL
+ */
+int NAME(laplace_tiles)(FLT* U, FLT* out, unsigned int width, FLT dx, unsigned int height, FLT dy, FLT* rhs, int steps, FLT* errors) {
+    FLT cx = dy * dy / (2 * dx * dx + 2 * dy * dy), cy = dx * dx / (2 * dx * dx + 2 * dy * dy);
+    unsigned int ntiles_x = (width - 2 + TILE_WIDTH - 1) / TILE_WIDTH, ntiles_y = (height - 2 + TILE_HEIGHT - 1) / TILE_HEIGHT;
+    size_t buffer_size = (TILE_WIDTH + 2 * steps + 2) * (TILE_HEIGHT + 2 * steps + 2);
+
+    /* two buffers per thread */
+    FLT* buffers = malloc(omp_get_max_threads() * 2 * buffer_size * sizeof(FLT));
+    if(buffers == NULL)
+        return -1;
+
+    for(int k=0; k < steps; k++)
+        errors[k] = .0f;
+
+    #pragma omp parallel reduction(max:errors[:steps])
+    {
+        FLT* a = &buffers[omp_get_thread_num() * 2 * buffer_size];
+        FLT* b = &a[buffer_size];
+
+        #pragma omp for collapse(2) schedule(static)
+        for(unsigned int ty=0; ty < ntiles_y; ty++) {
+            for(unsigned int tx=0; tx < ntiles_x; tx++) {
+                /* tile, and tile with its margin (clipped to the grid) */
+                int x0 = 1 + tx * TILE_WIDTH, x1 = (int) fmin(x0 + TILE_WIDTH, width - 1);
+                int y0 = 1 + ty * TILE_HEIGHT, y1 = (int) fmin(y0 + TILE_HEIGHT, height - 1);
+                int mx0 = (int) fmax(x0 - steps, 0), mx1 = (int) fmin(x1 + steps, width);
+                int my0 = (int) fmax(y0 - steps, 0), my1 = (int) fmin(y1 + steps, height);
+                int bw = mx1 - mx0;
+
+                for(int y=my0; y < my1; y++) {
+                    for(int x=mx0; x < mx1; x++) {
+                        a[(y - my0) * bw + x - mx0] = G(x, y);
+                        b[(y - my0) * bw + x - mx0] = G(x, y);
+                    }
+                }
+
+                for(int k=0; k < steps; k++) {
+                    int rx0 = (int) fmax(x0 - steps + k + 1, 1), rx1 = (int) fmin(x1 + steps - k - 1, width - 1);
+                    int ry0 = (int) fmax(y0 - steps + k + 1, 1), ry1 = (int) fmin(y1 + steps - k - 1, height - 1);
+
+                    for(int y=ry0; y < ry1; y++) {
+                        FLT* row_a = &a[(y - my0) * bw - mx0];
+                        FLT* row_b = &b[(y - my0) * bw - mx0];
+                        JACOBI_ROW(&row_b[rx0], &row_a[rx0], (rhs != NULL) ? &rhs[y * width + rx0] : NULL, bw, rx1 - rx0, cx, cy); // the change is only computed on the tile, below
+                    }
+
+                    for(int y=y0; y < y1; y++) {
+                        for(int x=x0; x < x1; x++) {
+                            errors[k] = NAME(ffmax)(errors[k], fabs(a[(y - my0) * bw + x - mx0] - b[(y - my0) * bw + x - mx0]));
+                        }
+                    }
+
+                    FLT* swap = a;
+                    a = b;
+                    b = swap;
+                }
+
+                for(int y=y0; y < y1; y++) {
+                    for(int x=x0; x < x1; x++) {
+                        out[y * width + x] = a[(y - my0) * bw + x - mx0];
+                    }
+                }
+            }
+        }
+    }
+
+    free(buffers);
+    return 0;
+}
+
+/* Same as `laplace()`, but with temporal blocking: `depth` iterations are performed on each tile while it is in cache (see `laplace_tiles()`).
+ * The results are identical to the ones of `laplace()`: if the convergence is reached in the middle of a block, the block is computed again with less iterations.
+ * Returns the number of iterations, or -1 on error.
+ * U: function
+ * rhs: source term (see `source.h`), or NULL for the Laplace equation
+ * max_iter: maximal number of iteration
+ * threshold: minimal change
+ * depth: number of iterations per block
+ * checkpoint: where to save checkpoints (see `checkpoint.h`), or NULL
+ * telemetry: where to record the convergence (see `telemetry.h`), or NULL
+ */
+int NAME(laplace_blocked)(FLT* U, unsigned int width, FLT dx, unsigned int height, FLT dy, FLT* rhs, int max_iter, FLT threshold, int depth, Checkpoint* checkpoint, Telemetry* telemetry) {
+    if(U != NULL) {
+        FLT* values = U;
+        FLT* tmp = grid_alloc(width, height, sizeof(FLT));
+        FLT* errors = malloc(depth * sizeof(FLT));
+        if(tmp == NULL || errors == NULL) {
+            grid_free(tmp);
+            free(errors);
+            return -1;
+        }
+
+        #pragma omp parallel for schedule(static)
+        for(int y=0; y < height; y++) {
+            for(int x=0; x < width; x++) {
+                T(x, y) = G(x, y);
+            }
+        }
+
+        FLT error = .0f;
+        int iter, status = 0;
+        telemetry_start(telemetry, width, height, (rhs != NULL ? 3. : 2.) * sizeof(FLT) / depth, threshold); // (read `U` and `rhs`, write `tmp`, once per block)
+
+        for(iter=0; iter < max_iter; ) {
+            int steps = (int) fmin(depth, max_iter - iter), converged = -1;
+
+            if((status = NAME(laplace_tiles)(U, tmp, width, dx, height, dy, rhs, steps, errors)) != 0)
+                break;
+
+            for(int k=0; k < steps && converged < 0; k++) {
+                if(errors[k] < threshold)
+                    converged = k;
+            }
+
+            if(converged >= 0 && converged < steps - 1) {
+                steps = converged + 1;
+                if((status = NAME(laplace_tiles)(U, tmp, width, dx, height, dy, rhs, steps, errors)) != 0)
+                    break;
+            }
+
+            FLT* swap = U;
+            U = tmp;
+            tmp = swap;
+
+            iter += steps;
+            error = errors[steps - 1];
+            checkpoint_update(checkpoint, U, sizeof(FLT), width, height, iter, error);
+            telemetry_update(telemetry, iter, error);
+
+            if (converged >= 0) {
+                break;
+            }
+        }
+
+        printf("final error=%f\n", error);
+        telemetry_summary(telemetry, iter, error);
+
+        if(U != values) {
+            memcpy(values, U, width * height * sizeof(FLT));
+            tmp = U;
+        }
+
+        grid_free(tmp);
+        free(errors);
+        return (status == 0) ? iter : -1;
+    }
+}
+
+/* Get the optimal relaxation factor of SOR for the Laplace equation on a `width x height` grid.
+ * It is computed out of the spectral radius of the jacobi iteration, `rho`, as `omega = 2 / (1 + sqrt(1 - rho^2))`.
+ */
+FLT NAME(sor_omega)(unsigned int width, FLT dx, unsigned int height, FLT dy) {
+    FLT rho = (dy * dy * cos(M_PI / (width - 1)) + dx * dx * cos(M_PI / (height - 1))) / (dx * dx + dy * dy);
+    return 2 / (1 + sqrt(1 - rho * rho));
+}
+
+/* Update (in place) the points of row `y` which have the color `color`, with red-black SOR.
+ * Returns the maximal change, and add the squares of the changes to `squares` and the maximal absolute value of the new values to `magnitude` (if `squares` is not NULL, for the norms of `convergence.h`).
+ */
+FLT NAME(sor_row)(FLT* U, unsigned int width, FLT* rhs, int y, int color, FLT cx, FLT cy, FLT omega, double* squares, FLT* magnitude) {
+    FLT error = .0f;
+
+    if(squares != NULL) {
+        double sum = .0;
+        FLT largest = *magnitude;
+
+        #pragma omp simd reduction(max:error,largest) reduction(+:sum)
+        for(int x=1 + (1 + y + color) % 2; x < (width - 1); x += 2) {
+            FLT change = omega * (cx * ( G(x+1, y) + G(x-1, y) ) + cy * ( G(x, y+1) + G(x, y-1) ) + ((rhs != NULL) ? rhs[y * width + x] : 0) - G(x, y));
+            error = NAME(ffmax)(error, fabs(change));
+            sum += change * change;
+            G(x, y) += change;
+            largest = NAME(ffmax)(largest, fabs(G(x, y)));
+        }
+
+        *squares += sum;
+        *magnitude = largest;
+    } else if(rhs == NULL) {
+        #pragma omp simd reduction(max:error)
+        for(int x=1 + (1 + y + color) % 2; x < (width - 1); x += 2) {
+            FLT change = omega * (cx * ( G(x+1, y) + G(x-1, y) ) + cy * ( G(x, y+1) + G(x, y-1) ) - G(x, y));
+            error = NAME(ffmax)(error, fabs(change));
+            G(x, y) += change;
+        }
+    } else {
+        #pragma omp simd reduction(max:error)
+        for(int x=1 + (1 + y + color) % 2; x < (width - 1); x += 2) {
+            FLT change = omega * (cx * ( G(x+1, y) + G(x-1, y) ) + cy * ( G(x, y+1) + G(x, y-1) ) + rhs[y * width + x] - G(x, y));
+            error = NAME(ffmax)(error, fabs(change));
+            G(x, y) += change;
+        }
+    }
+
+    return error;
+}
+
+/* Compute the Laplace equation with red-black successive over-relaxation (SOR), until the maximal change is lower than `threshold` or the number of iteration exceed `max_iter`.
+ * The points are colored as a checkerboard, and each iteration updates (in place) all the red points, then all the black ones.
+ * Since the points of a given color only depends on the points of the other color, each of these sweeps can be done in parallel.
+ * As for `laplace()`, `convergence` selects the iterations at which the change is reduced over the threads, and its norm.
+ * Returns the number of iterations, or -1 on error.
+ * U: function
+ * rhs: source term (see `source.h`), or NULL for the Laplace equation
+ * max_iter: maximal number of iteration
+ * threshold: minimal change
+ * omega: relaxation factor (between 1 and 2, see `sor_omega()`)
+ * checkpoint: where to save checkpoints (see `checkpoint.h`), or NULL
+ * telemetry: where to record the convergence (see `telemetry.h`), or NULL
+ * convergence: when and how to check the convergence (see `convergence.h`), or NULL for the maximal change at each iteration
+ */
+int NAME(laplace_sor)(FLT* U, unsigned int width, FLT dx, unsigned int height, FLT dy, FLT* rhs, int max_iter, FLT threshold, FLT omega, Checkpoint* checkpoint, Telemetry* telemetry, Convergence* convergence) {
+    if(U != NULL) {
+        FLT cx = dy * dy / (2 * dx * dx + 2 * dy * dy), cy = dx * dx / (2 * dx * dx + 2 * dy * dy);
+        FLT error = .0f;
+        int iter, norm = convergence_norm(convergence);
+        telemetry_start(telemetry, width, height, (rhs != NULL ? 4 : 3) * sizeof(FLT), threshold); // (read `U` twice, write half of it twice, and read `rhs`)
+        convergence_start(convergence, 0);
+
+        for(iter=0; iter < max_iter; iter++) {
+            int check = convergence_due(convergence, iter + 1, max_iter);
+            FLT change = .0f, magnitude = .0f;
+            double squares = .0;
+
+            #pragma omp parallel
+            {
+                for(int color=0; color < 2; color++) {
+                    if(check) {
+                        #pragma omp for reduction(max:change,magnitude) reduction(+:squares) schedule(static)
+                        for(int y=1; y < (height - 1); y++)
+                            change = NAME(ffmax)(change, NAME(sor_row)(U, width, rhs, y, color, cx, cy, omega, (norm != NORM_MAX) ? &squares : NULL, &magnitude));
+                    } else {
+                        /* (the change is not needed: no reduction) */
+                        #pragma omp for schedule(static)
+                        for(int y=1; y < (height - 1); y++)
+                            NAME(sor_row)(U, width, rhs, y, color, cx, cy, omega, NULL, NULL);
+                    }
+                }
+            }
+
+            if(check)
+                error = convergence_error(convergence, change, squares, magnitude, (double) (width - 2) * (height - 2));
+
+            checkpoint_update(checkpoint, U, sizeof(FLT), width, height, iter + 1, error);
+            if(!check)
+                continue;
+
+            telemetry_update(telemetry, iter + 1, error);
+            convergence_update(convergence, iter + 1, error, threshold);
+
+            if (error < threshold) {
+                iter++;
+                break;
+            }
+        }
+
+        printf("final error=%f\n", error);
+        telemetry_summary(telemetry, iter, error);
+
+        return iter;
+    }
+}
+
+/* Solve with jacobi (`depth` iterations per block if `depth > 1`) or red-black SOR (if `solver` is `SOR`), with the source term `rhs` (if not NULL), with checkpoints and telemetry if `checkpoint` and `telemetry` are not NULL.
+ * The convergence checks of `convergence` (if not NULL) are only available without blocks (`depth <= 1`), since the blocked version only gets the change at the end of each block.
+ * Returns the number of iterations, or -1 on error.
+ */
+int NAME(laplace_solve)(FLT* U, unsigned int width, FLT dx, unsigned int height, FLT dy, FLT* rhs, int max_iter, FLT threshold, int solver, int depth, FLT omega, Checkpoint* checkpoint, Telemetry* telemetry, Convergence* convergence) {
+    if(solver == SOR)
+        return NAME(laplace_sor)(U, width, dx, height, dy, rhs, max_iter, threshold, omega, checkpoint, telemetry, convergence);
+    else if(depth > 1)
+        return (convergence == NULL) ? NAME(laplace_blocked)(U, width, dx, height, dy, rhs, max_iter, threshold, depth, checkpoint, telemetry) : -1;
+    else
+        return NAME(laplace)(U, width, dx, height, dy, rhs, max_iter, threshold, checkpoint, telemetry, convergence);
+}
@@ -0,0 +1,358 @@
+#ifndef LAPLACE_H
+#define LAPLACE_H
+
+/* Solver library: the solvers of the OMP version, and a context (`LaplaceSolver`) to use them from another program.
+ *
+ * The context owns its grid, and can be reused for many problems: the memory is kept by the arena (see `../arena.h`) and the threads by the OMP runtime, so that a service which embeds the solver only pays for the computation of each request.
+ * Usage:
+ * 1. `laplace_solver_new()`, with a backend (`serial`, or `omp`; there is no distributed backend yet, since the MPI version needs all the ranks to take part in each call),
+ * 2. `laplace_solver_setup()` with the size of the grid (which zeroes it), then `laplace_solver_image()` for the boundary conditions (or write them directly in `values`, which can also hold an initial guess),
+ * 3. optionally, set the options of the context (solver, threshold, etc) and `laplace_solver_progress()` to get a callback every few iterations,
+ * 4. `laplace_solver_solve()`, after which the result is in `values` (then go back to 2 for the next problem),
+ * 5. `laplace_solver_delete()`.
+ * In single precision, the caller should flush the subnormal numbers to zero (see `3_omp.c`).
+ *
+ * Requires `image_ppm.h` and `common.h`.
+ */
+
+#include <math.h>
+#include <omp.h>
+#include "multigrid.h"
+#include "dst.h"
+#include "cg.h"
+#include "simd.h"
+#include "placement.h"
+#include "field.h"
+#include "checkpoint.h"
+#include "telemetry.h"
+#include "convergence.h"
+#include "guess.h"
+#include "source.h"
+
+#define G(x,y) (U[(y) * width + (x)])
+#define T(x,y) (tmp[(y) * width + (x)])
+
+/* jacobi and SOR solvers, in both precisions (`laplace_float()`, `laplace_double()`, etc)
+ */
+#pragma push_macro("FLT")
+#undef FLT
+
+#define FLT float
+#define NAME(name) name##_float
+#include "jacobi.h"
+#undef FLT
+#undef NAME
+
+#define FLT double
+#define NAME(name) name##_double
+#include "jacobi.h"
+#undef FLT
+#undef NAME
+
+#pragma pop_macro("FLT")
+
+#define REFINE_RATIO 1e-3 // the residual is reduced by (at least) that much by each refinement
+
+/* Compute, in double precision, the change that a jacobi iteration would make (with the source term `rhs`, if not NULL), `r = J(U) - U`, and store it in single precision.
+ * Returns the maximal absolute value of `r`.
+ */
+double refine_residual(double* U, double* rhs, float* r, unsigned int width, double dx, unsigned int height, double dy) {
+    double cx = dy * dy / (2 * dx * dx + 2 * dy * dy), cy = dx * dx / (2 * dx * dx + 2 * dy * dy), error = .0;
+
+    #pragma omp parallel for reduction(max:error) schedule(static)
+    for(int y=1; y < (height - 1); y++) {
+        for(int x=1; x < (width - 1); x++) {
+            double change = cx * ( G(x+1, y) + G(x-1, y) ) + cy * ( G(x, y+1) + G(x, y-1) ) + ((rhs != NULL) ? rhs[y * width + x] : .0) - G(x, y);
+            r[y * width + x] = (float) change;
+            error = fmax(error, fabs(change));
+        }
+    }
+
+    return error;
+}
+
+/* Compute the Laplace equation with mixed-precision iterative refinement, until the maximal change is lower than `threshold` or the number of iteration exceed `max_iter`.
+ * Since the jacobi iteration is affine, `J(U + e) = J(U) + J0(e)`, where `J0` is the jacobi iteration with zero boundary conditions (and no source term).
+ * Thus, the correction `e` such that `U + e` is a fixed point satisfies `e = J0(e) + r`, where `r = J(U) - U` is the residual.
+ * Each refinement computes `r` in double precision, then solves for `e` with jacobi iterations in single precision (thus with half the memory traffic), and finally adds it to `U` in double precision.
+ * The result has the accuracy of the double precision version.
+ * Returns the number of (single precision) iterations, or -1 on error.
+ * U: function
+ * rhs: source term (see `source.h`), or NULL
+ * max_iter: maximal number of iteration
+ * threshold: minimal change
+ * checkpoint: where to save checkpoints (see `checkpoint.h`), or NULL
+ * telemetry: where to record the convergence (see `telemetry.h`), or NULL
+ */
+int laplace_mixed(double* U, unsigned int width, double dx, unsigned int height, double dy, double* rhs, int max_iter, double threshold, Checkpoint* checkpoint, Telemetry* telemetry) {
+    if(U != NULL) {
+        size_t n = width * height;
+        float* r = grid_alloc(width, height, sizeof(float));
+        float* e = grid_alloc(width, height, sizeof(float));
+        float* e_next = grid_alloc(width, height, sizeof(float)); // the boundaries of `e` and `e_next` are kept to zero
+        if(r == NULL || e == NULL || e_next == NULL) {
+            grid_free(r);
+            grid_free(e);
+            grid_free(e_next);
+            return -1;
+        }
+
+        float cx = dy * dy / (2 * dx * dx + 2 * dy * dy), cy = dx * dx / (2 * dx * dx + 2 * dy * dy);
+        double error = refine_residual(U, rhs, r, width, dx, height, dy);
+        int iter = 0, refinements = 0;
+        telemetry_start(telemetry, width, height, 3 * sizeof(float), threshold); // (read `e` and `r`, write `e_next`)
+
+        while(iter < max_iter && error >= threshold) {
+            float target = fmax(threshold, REFINE_RATIO * error), change = INFINITY, previous;
+            memset(e, 0, n * sizeof(float));
+
+            /* in exact arithmetic, the maximal change of the jacobi iteration never increases: when it does, it is rounding noise, and the correction is as good as it gets */
+            do {
+                previous = change;
+                change = .0f;
+
+                #pragma omp parallel for reduction(max:change) schedule(static)
+                for(int y=1; y < (height - 1); y++) {
+                    change = fmaxf(change, JACOBI_ROW(&e_next[y * width + 1], &e[y * width + 1], &r[y * width + 1], width, width - 2, cx, cy));
+                }
+
+                float* swap = e;
+                e = e_next;
+                e_next = swap;
+                iter++;
+                telemetry_update(telemetry, iter, change);
+            } while(iter < max_iter && change >= target && change < previous);
+
+            #pragma omp parallel for schedule(static)
+            for(size_t i=0; i < n; i++)
+                U[i] += e[i];
+
+            error = refine_residual(U, rhs, r, width, dx, height, dy);
+            refinements++;
+            checkpoint_update(checkpoint, U, sizeof(double), width, height, iter, error);
+        }
+
+        printf("final error=%f\n", error);
+        printf("refinements = %d\n", refinements);
+        telemetry_summary(telemetry, iter, error);
+
+        grid_free(r);
+        grid_free(e);
+        grid_free(e_next);
+        return iter;
+    }
+}
+
+/* Get a copy of `values` in single (if `precision` is `SINGLE`) or double precision, or `values` itself if it is already in that precision.
+ */
+void* precision_copy(FLT* values, unsigned int width, unsigned int height, int precision) {
+    size_t size = (precision == SINGLE) ? sizeof(float) : sizeof(double), n = (size_t) width * height;
+    if(size == sizeof(FLT))
+        return values;
+
+    void* copy = grid_alloc(width, height, size);
+    if(copy != NULL) {
+        #pragma omp parallel for schedule(static)
+        for(size_t i=0; i < n; i++) {
+            if(precision == SINGLE)
+                ((float*) copy)[i] = (float) values[i];
+            else
+                ((double*) copy)[i] = (double) values[i];
+        }
+    }
+
+    return copy;
+}
+
+/* Put back the content of `copy` (see `precision_copy()`) in `values`, and free it.
+ */
+void precision_restore(FLT* values, void* copy, unsigned int width, unsigned int height, int precision) {
+    size_t n = (size_t) width * height;
+    if(copy == values)
+        return;
+
+    #pragma omp parallel for schedule(static)
+    for(size_t i=0; i < n; i++)
+        values[i] = (precision == SINGLE) ? (FLT) ((float*) copy)[i] : (FLT) ((double*) copy)[i];
+
+    grid_free(copy);
+}
+
+/* Solve with `solver`, in `precision` (for jacobi and SOR), starting from `values`, with the source `f` if not NULL (for jacobi and SOR only, see `source.h`), with checkpoints, telemetry and convergence checks if `checkpoint`, `telemetry` and `convergence` are not NULL.
+ * The convergence checks are only available for jacobi (without blocks) and SOR, in single or double precision (see `convergence.h`).
+ * Returns the number of iterations, or -1 on error.
+ */
+int solve(FLT* values, FLT* f, unsigned int width, unsigned int height, int niter, FLT threshold, int solver, int precision, int depth, FLT omega, int precondition, Checkpoint* checkpoint, Telemetry* telemetry, Convergence* convergence) {
+    if((f != NULL || convergence != NULL) && solver != JACOBI && solver != SOR)
+        return -1;
+    else if(convergence != NULL && (precision == MIXED || (solver == JACOBI && depth > 1)))
+        return -1;
+    else if(solver == MULTIGRID)
+        return laplace_multigrid(values, width, .1, height, .1, niter, threshold);
+    else if(solver == DIRECT)
+        return laplace_dst(values, width, .1, height, .1, NULL);
+    else if(solver == CONJUGATE_GRADIENT)
+        return laplace_cg(values, width, .1, height, .1, niter, threshold, precondition, NULL);
+
+    int result;
+    void* U = precision_copy(values, width, height, precision);
+    void* rhs = (f != NULL) ? source_rhs(f, width, .1, height, .1, precision) : NULL;
+    if(U == NULL || (f != NULL && rhs == NULL)) {
+        if(U != NULL && U != values) // (see `precision_copy()`)
+            grid_free(U);
+        grid_free(rhs);
+        return -1;
+    }
+
+    if(precision == MIXED)
+        result = laplace_mixed(U, width, .1, height, .1, rhs, niter, threshold, checkpoint, telemetry);
+    else if(precision == SINGLE)
+        result = laplace_solve_float(U, width, .1, height, .1, rhs, niter, threshold, solver, depth, omega, checkpoint, telemetry, convergence);
+    else
+        result = laplace_solve_double(U, width, .1, height, .1, rhs, niter, threshold, solver, depth, omega, checkpoint, telemetry, convergence);
+
+    precision_restore(values, U, width, height, precision);
+    grid_free(rhs);
+    return result;
+}
+
+/* Backends of the solver library, the names are given in the same order in `BACKENDS` */
+enum {
+    BACKEND_SERIAL,
+    BACKEND_OMP,
+    BACKEND_MPI // (not available yet)
+};
+
+const char* BACKENDS[] = {"serial", "omp", "mpi", NULL};
+
+typedef struct LaplaceSolver_ {
+    int backend;
+
+    /* options of `solve()`, which can be changed between two solves (`omega = 0` selects the optimal one for SOR) */
+    int solver, precision, depth, precondition, max_iter;
+    FLT threshold, omega;
+
+    /* grid (owned by the context) */
+    unsigned int width, height;
+    FLT* values;
+
+    /* source term of the Poisson equation (`width x height`, see `source.h`), or NULL for the Laplace equation (not owned by the context) */
+    FLT* source;
+
+    /* progress (NULL if there is no callback) */
+    Telemetry* telemetry;
+
+    /* convergence checks (NULL to check the maximal change at each iteration, see `laplace_solver_convergence()`) */
+    Convergence* convergence;
+
+    /* result of the last solve */
+    int iterations;
+} LaplaceSolver;
+
+/* Create a solver context, with the default options (jacobi, in the precision of `FLT`, see `common.h`).
+ * Returns NULL if `backend` is not available.
+ */
+LaplaceSolver* laplace_solver_new(int backend) {
+    if(backend != BACKEND_SERIAL && backend != BACKEND_OMP)
+        return NULL;
+
+    LaplaceSolver* solver = malloc(sizeof(LaplaceSolver));
+    if(solver == NULL)
+        return NULL;
+
+    *solver = (LaplaceSolver) {
+        .backend = backend, .solver = JACOBI, .precision = (sizeof(FLT) == sizeof(float)) ? SINGLE : DOUBLE, .depth = 1, .precondition = 0,
+        .max_iter = DEFAULT_NITER, .threshold = DEFAULT_THRESHOLD, .omega = 0,
+        .width = 0, .height = 0, .values = NULL, .source = NULL, .telemetry = NULL, .convergence = NULL, .iterations = -1
+    };
+
+    simd_select(NULL); // (the best row kernels, which can be changed afterwards with `simd_select()`)
+
+    return solver;
+}
+
+/* Set the size of the grid to `width x height` (the grid is kept if it already has that size), and set all its values to zero.
+ * Returns 0 on success, -1 on error.
+ */
+int laplace_solver_setup(LaplaceSolver* solver, unsigned int width, unsigned int height) {
+    if(width < 3 || height < 3)
+        return -1;
+
+    if(solver->values == NULL || solver->width != width || solver->height != height) {
+        grid_free(solver->values);
+        solver->values = grid_alloc(width, height, sizeof(FLT));
+        solver->width = width;
+        solver->height = height;
+        return (solver->values != NULL) ? 0 : -1;
+    }
+
+    grid_touch(solver->values, width, height, sizeof(FLT));
+    return 0;
+}
+
+/* Set the boundary conditions to the ones of the input image `in` (resampled to the size of the grid, see `fill_boundaries()`), the other values are kept.
+ */
+void laplace_solver_image(LaplaceSolver* solver, Image* in) {
+    fill_boundaries(in, solver->values, solver->width, solver->height);
+}
+
+/* Call `callback(data, iteration, error)` every `period` iterations of the next solves (jacobi and SOR only), or stop calling it if `callback` is NULL.
+ * Returns 0 on success, -1 on error.
+ */
+int laplace_solver_progress(LaplaceSolver* solver, void (*callback)(void*, int, double), void* data, int period) {
+    telemetry_delete(solver->telemetry);
+    solver->telemetry = NULL;
+    if(callback == NULL)
+        return 0;
+
+    solver->telemetry = telemetry_new(NULL, period);
+    if(solver->telemetry == NULL)
+        return -1;
+
+    solver->telemetry->callback = callback;
+    solver->telemetry->data = data;
+    return 0;
+}
+
+/* Check the convergence of the next solves (jacobi without blocks and SOR only) with `norm`, every `period` iterations (see `convergence.h`).
+ * Returns 0 on success, -1 on error.
+ */
+int laplace_solver_convergence(LaplaceSolver* solver, int norm, int period) {
+    free(solver->convergence);
+    solver->convergence = convergence_new(norm, period);
+    return (solver->convergence != NULL) ? 0 : -1;
+}
+
+/* Solve the problem in `values`, with the options of the context.
+ * Returns the number of iterations (also stored in `iterations`), or -1 on error.
+ */
+int laplace_solver_solve(LaplaceSolver* solver) {
+    /* (same restrictions as the command line of `3_omp.c`) */
+    if(solver->values == NULL || (solver->solver != JACOBI && solver->solver != SOR && (solver->precision == MIXED || (solver->precision == SINGLE) != (sizeof(FLT) == sizeof(float)))) || (solver->solver == SOR && solver->precision == MIXED))
+        return -1;
+
+    FLT omega = (solver->solver == SOR && solver->omega == 0) ? sor_omega_double(solver->width, .1, solver->height, .1) : solver->omega;
+
+    /* the serial backend runs the same code with a single thread (this only changes the number of threads of the calling thread) */
+    int nthreads = omp_get_max_threads();
+    if(solver->backend == BACKEND_SERIAL)
+        omp_set_num_threads(1);
+
+    solver->iterations = solve(solver->values, solver->source, solver->width, solver->height, solver->max_iter, solver->threshold, solver->solver, solver->precision, solver->depth, omega, solver->precondition, NULL, solver->telemetry, solver->convergence);
+
+    omp_set_num_threads(nthreads);
+    return solver->iterations;
+}
+
+/* Free the context (and its grid).
+ */
+void laplace_solver_delete(LaplaceSolver* solver) {
+    if(solver != NULL) {
+        grid_free(solver->values);
+        telemetry_delete(solver->telemetry);
+        free(solver->convergence);
+        free(solver);
+    }
+}
+
+#endif // LAPLACE_H
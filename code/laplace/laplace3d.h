@@ -0,0 +1,285 @@
+#ifndef LAPLACE3D_H
+#define LAPLACE3D_H
+
+/* 3D version of the solvers: 7-point jacobi and red-black SOR stencils on a `width x height x depth` grid, stored plane by plane (`z`), then row by row (`y`).
+ *
+ * The planes are too large to stay in cache (a 512x512 plane of doubles is 2 MiB), so that a plain sweep would read each value three times from memory (for the planes `z - 1`, `z` and `z + 1`).
+ * Thus, the sweeps use 2.5D blocking: the `(x, y)` plane is cut in tiles of `TILE3D_WIDTH x TILE3D_HEIGHT` points, and each tile is streamed along `z`, so that only one new plane of the tile is read from memory at each step, the two others being still in cache.
+ * The threads get contiguous slabs of planes (`schedule(static)` over `1 <= z < depth - 1`), in which they stream all the tiles.
+ * The grids are allocated with `grid_alloc()`, by planes, so that the slab of each thread is placed on its NUMA node.
+ *
+ * The Dirichlet boundary conditions (the six faces of the grid) are given by a stack of images (see `fill_faces()`) or by a raw file (see `read_raw()`).
+ *
+ * Requires `common.h` (for `FLT` and `ffmax()`), `image_ppm.h` and `placement.h` (for `grid_alloc()`).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <math.h>
+
+/* size of the tiles: the 3 input planes and the output plane of a tile should fit in the L2 cache (512 KiB, in double precision) */
+#ifndef TILE3D_WIDTH
+#define TILE3D_WIDTH 512
+#endif
+
+#ifndef TILE3D_HEIGHT
+#define TILE3D_HEIGHT 32
+#endif
+
+#define V(x,y,z) (U[((size_t) (z) * height + (y)) * width + (x)])
+#define W(x,y,z) (tmp[((size_t) (z) * height + (y)) * width + (x)])
+
+/* Faces of the grid, in the order of the stack of images */
+enum {
+    FACE_BOTTOM, // z = 0
+    FACE_TOP, // z = depth - 1
+    FACE_SOUTH, // y = 0
+    FACE_NORTH, // y = height - 1
+    FACE_WEST, // x = 0
+    FACE_EAST, // x = width - 1
+    FACES
+};
+
+/* Get the value of the point at `(u, v)` (both between 0 and 1) of `face`, out of the stack of images `in` (see `fill_faces()`), with a bilinear interpolation.
+ */
+FLT face_value(Image* in, int face, double u, double v) {
+    unsigned int face_height = in->height / FACES;
+    double px = u * (in->width - 1), py = v * (face_height - 1);
+    unsigned int x = (px < in->width - 1) ? (unsigned int) px : (in->width > 1 ? in->width - 2 : 0);
+    unsigned int y = (py < face_height - 1) ? (unsigned int) py : (face_height > 1 ? face_height - 2 : 0);
+    unsigned int x1 = (x + 1 < in->width) ? x + 1 : x, y1 = (y + 1 < face_height) ? y + 1 : y;
+    double fx = px - x, fy = py - y;
+
+    double value = .0;
+    unsigned int xs[2] = {x, x1}, ys[2] = {y, y1};
+    double weights[2][2] = {{(1 - fx) * (1 - fy), fx * (1 - fy)}, {(1 - fx) * fy, fx * fy}};
+    for(int j=0; j < 2; j++) {
+        for(int i=0; i < 2; i++) {
+            unsigned char* pixel = &in->pixels[3 * ((size_t) (face * face_height + ys[j]) * in->width + xs[i])];
+            value += weights[j][i] * (pixel[0] - pixel[2]) / 255.;
+        }
+    }
+
+    return value;
+}
+
+/* Set the six faces of `U` (a `width x height x depth` grid) to the boundary conditions given by the stack of images `in`.
+ * The image is made of `FACES` blocks of the same height, stacked vertically in the order of the `FACE_*` constants, which give the values of each face as in the 2D version (red for positive values, blue for negative ones).
+ * Each block is resampled (bilinearly) to its face: `(x, y)` for the bottom and top faces, `(x, z)` for the south and north ones, and `(y, z)` for the west and east ones (where two faces meet, the last one of the stack is used).
+ * Returns 0 on success, -1 if the image is too small.
+ */
+int fill_faces(Image* in, FLT* U, unsigned int width, unsigned int height, unsigned int depth) {
+    if(in->height < FACES || in->width < 1)
+        return -1;
+
+    #pragma omp parallel for schedule(static)
+    for(int y=0; y < height; y++) {
+        for(int x=0; x < width; x++) {
+            V(x, y, 0) = face_value(in, FACE_BOTTOM, (double) x / (width - 1), (double) y / (height - 1));
+            V(x, y, depth - 1) = face_value(in, FACE_TOP, (double) x / (width - 1), (double) y / (height - 1));
+        }
+    }
+
+    #pragma omp parallel for schedule(static)
+    for(int z=0; z < depth; z++) {
+        for(int x=0; x < width; x++) {
+            V(x, 0, z) = face_value(in, FACE_SOUTH, (double) x / (width - 1), (double) z / (depth - 1));
+            V(x, height - 1, z) = face_value(in, FACE_NORTH, (double) x / (width - 1), (double) z / (depth - 1));
+        }
+
+        for(int y=0; y < height; y++) {
+            V(0, y, z) = face_value(in, FACE_WEST, (double) y / (height - 1), (double) z / (depth - 1));
+            V(width - 1, y, z) = face_value(in, FACE_EAST, (double) y / (height - 1), (double) z / (depth - 1));
+        }
+    }
+
+    return 0;
+}
+
+/* Read the `width x height x depth` values of `U` from the raw file at `path` (the values of type `FLT`, in the same order as in memory, without header).
+ * The faces give the boundary conditions, and the interior the initial guess.
+ * Returns 0 on success, -1 if the file cannot be opened, and -2 if it is too short.
+ */
+int read_raw(const char* path, FLT* U, unsigned int width, unsigned int height, unsigned int depth) {
+    FILE* f = fopen(path, "rb");
+    if(f == NULL)
+        return -1;
+
+    size_t count = (size_t) width * height * depth, n = fread(U, sizeof(FLT), count, f);
+    fclose(f);
+    return (n == count) ? 0 : -2;
+}
+
+/* Write the `width x height x depth` values of `U` in the raw file at `path` (in the format of `read_raw()`).
+ * Returns 0 on success, -1 if the file cannot be opened, and -2 if it cannot be written.
+ */
+int write_raw(const char* path, FLT* U, unsigned int width, unsigned int height, unsigned int depth) {
+    FILE* f = fopen(path, "wb");
+    if(f == NULL)
+        return -1;
+
+    size_t count = (size_t) width * height * depth, n = fwrite(U, sizeof(FLT), count, f);
+    return (fclose(f) == 0 && n == count) ? 0 : -2;
+}
+
+/* Row kernel of the 3D jacobi stencil: computes `out[x]` for `0 <= x < n` (out of the neighbors at `±1`, `±width` and `±plane`), and returns the maximal change.
+ */
+FLT jacobi3d_row(FLT* out, FLT* in, int n, ptrdiff_t width, ptrdiff_t plane, FLT cx, FLT cy, FLT cz) {
+    FLT error = .0;
+
+    #pragma omp simd reduction(max:error)
+    for(int x=0; x < n; x++) {
+        out[x] = cx * (in[x+1] + in[x-1]) + cy * (in[x+width] + in[x-width]) + cz * (in[x+plane] + in[x-plane]);
+        error = ffmax(error, fabs(out[x] - in[x]));
+    }
+
+    return error;
+}
+
+/* Compute the 3D Laplace equation with jacobi, until the maximal change is lower than `threshold` or the number of iteration exceed `max_iter`.
+ * The faces are used to get the values for the Dirichlet boundary conditions.
+ * Each iteration is a 2.5D blocked sweep (see above) from `U` to a second buffer, then the two buffers are swapped.
+ * Returns the number of iterations, or -1 on error.
+ * U: function
+ * max_iter: maximal number of iteration
+ * threshold: minimal change
+ */
+int laplace3d(FLT* U, unsigned int width, FLT dx, unsigned int height, FLT dy, unsigned int depth, FLT dz, int max_iter, FLT threshold) {
+    FLT* values = U;
+    FLT* tmp = grid_alloc(width * height, depth, sizeof(FLT));
+    if(tmp == NULL)
+        return -1;
+
+    /* both buffers hold the boundary conditions */
+    size_t plane = (size_t) width * height;
+    memcpy(tmp, U, plane * sizeof(FLT));
+    memcpy(&W(0, 0, depth - 1), &V(0, 0, depth - 1), plane * sizeof(FLT));
+
+    #pragma omp parallel for schedule(static)
+    for(int z=1; z < (depth - 1); z++) {
+        memcpy(&W(0, 0, z), &V(0, 0, z), plane * sizeof(FLT));
+    }
+
+    /* `out = cx * (x neighbors) + cy * (y neighbors) + cz * (z neighbors)` */
+    FLT d = 2 / (dx * dx) + 2 / (dy * dy) + 2 / (dz * dz);
+    FLT cx = 1 / (dx * dx * d), cy = 1 / (dy * dy * d), cz = 1 / (dz * dz * d);
+
+    FLT error = .0;
+    int iter;
+
+    for(iter=0; iter < max_iter; iter++) {
+        error = .0;
+
+        #pragma omp parallel reduction(max:error)
+        {
+            for(int ty=1; ty < (height - 1); ty += TILE3D_HEIGHT) {
+                for(int tx=1; tx < (width - 1); tx += TILE3D_WIDTH) {
+                    int n = (tx + TILE3D_WIDTH < width - 1) ? TILE3D_WIDTH : width - 1 - tx;
+                    int y_end = (ty + TILE3D_HEIGHT < height - 1) ? ty + TILE3D_HEIGHT : height - 1;
+
+                    /* (the same slab of planes for each tile, no need to wait for the other threads) */
+                    #pragma omp for schedule(static) nowait
+                    for(int z=1; z < (depth - 1); z++) {
+                        for(int y=ty; y < y_end; y++)
+                            error = ffmax(error, jacobi3d_row(&W(tx, y, z), &V(tx, y, z), n, width, plane, cx, cy, cz));
+                    }
+                }
+            }
+        }
+
+        /* the new values become the current ones */
+        FLT* swap = U;
+        U = tmp;
+        tmp = swap;
+
+        if(error < threshold) {
+            iter++;
+            break;
+        }
+    }
+
+    printf("final error=%f\n", error);
+
+    /* the result must end up in the caller's buffer */
+    if(U != values) {
+        #pragma omp parallel for schedule(static)
+        for(int z=1; z < (depth - 1); z++) {
+            memcpy(&values[z * plane], &U[z * plane], plane * sizeof(FLT));
+        }
+
+        tmp = U;
+    }
+
+    grid_free(tmp);
+    return iter;
+}
+
+/* Get the optimal relaxation factor of SOR for the 3D Laplace equation on a `width x height x depth` grid (see `sor_omega()` for the 2D version).
+ */
+FLT sor_omega3d(unsigned int width, FLT dx, unsigned int height, FLT dy, unsigned int depth, FLT dz) {
+    FLT d = 1 / (dx * dx) + 1 / (dy * dy) + 1 / (dz * dz);
+    FLT rho = (cos(M_PI / (width - 1)) / (dx * dx) + cos(M_PI / (height - 1)) / (dy * dy) + cos(M_PI / (depth - 1)) / (dz * dz)) / d;
+    return 2 / (1 + sqrt(1 - rho * rho));
+}
+
+/* Compute the 3D Laplace equation with red-black successive over-relaxation (SOR), until the maximal change is lower than `threshold` or the number of iteration exceed `max_iter`.
+ * The points are colored by the parity of `x + y + z`, and each iteration updates (in place) all the red points, then all the black ones, each of these sweeps being 2.5D blocked.
+ * Returns the number of iterations, or -1 on error.
+ * U: function
+ * max_iter: maximal number of iteration
+ * threshold: minimal change
+ * omega: relaxation factor (between 1 and 2, see `sor_omega3d()`)
+ */
+int laplace3d_sor(FLT* U, unsigned int width, FLT dx, unsigned int height, FLT dy, unsigned int depth, FLT dz, int max_iter, FLT threshold, FLT omega) {
+    ptrdiff_t row_size = width, plane = (ptrdiff_t) width * height; // (signed, since the neighbors are also at negative offsets)
+    FLT d = 2 / (dx * dx) + 2 / (dy * dy) + 2 / (dz * dz);
+    FLT cx = 1 / (dx * dx * d), cy = 1 / (dy * dy * d), cz = 1 / (dz * dz * d);
+
+    FLT error = .0;
+    int iter;
+
+    for(iter=0; iter < max_iter; iter++) {
+        error = .0;
+
+        #pragma omp parallel reduction(max:error)
+        {
+            for(int color=0; color < 2; color++) {
+                for(int ty=1; ty < (height - 1); ty += TILE3D_HEIGHT) {
+                    for(int tx=1; tx < (width - 1); tx += TILE3D_WIDTH) {
+                        int x_end = (tx + TILE3D_WIDTH < width - 1) ? tx + TILE3D_WIDTH : width - 1;
+                        int y_end = (ty + TILE3D_HEIGHT < height - 1) ? ty + TILE3D_HEIGHT : height - 1;
+
+                        #pragma omp for schedule(static) nowait
+                        for(int z=1; z < (depth - 1); z++) {
+                            for(int y=ty; y < y_end; y++) {
+                                FLT* row = &V(0, y, z);
+
+                                #pragma omp simd reduction(max:error)
+                                for(int x=tx + (tx + y + z + color) % 2; x < x_end; x += 2) {
+                                    FLT change = omega * (cx * (row[x+1] + row[x-1]) + cy * (row[x+row_size] + row[x-row_size]) + cz * (row[x+plane] + row[x-plane]) - row[x]);
+                                    error = ffmax(error, fabs(change));
+                                    row[x] += change;
+                                }
+                            }
+                        }
+                    }
+                }
+
+                /* (the other color needs all the points of this one) */
+                #pragma omp barrier
+            }
+        }
+
+        if(error < threshold) {
+            iter++;
+            break;
+        }
+    }
+
+    printf("final error=%f\n", error);
+    return iter;
+}
+
+#endif // LAPLACE3D_H
@@ -0,0 +1,98 @@
+#ifndef MULTI_H
+#define MULTI_H
+
+/* Jacobi on many problems of the same size at once, with the interleaved kernels of `simd.h`.
+ *
+ * The grid holds `MULTI_LANES` problems (in double precision), with the values of a given point next to each other, so that a sweep updates all of them with full vector loads and stores (and the loop overheads, the indexing and the synchronizations are shared).
+ * Each lane converges on its own: as soon as the change of a lane is below the threshold, its problem is retired (its values are copied out, and are no longer updated), and the next problem of the queue is loaded in that lane.
+ * Thus, all the lanes are busy until the queue is empty, whatever the number of iterations of each problem, and each problem gets exactly the same values (and number of iterations) as with `laplace()`.
+ *
+ * Requires `simd.h` (for `jacobi_multi()`) and `placement.h` (for `grid_alloc()`).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/* Copy the `width x height` grid `values` in the lane `k` of `U`.
+ */
+void multi_load(double* U, unsigned int width, unsigned int height, int k, FLT* values) {
+    #pragma omp parallel for schedule(static)
+    for(size_t i=0; i < (size_t) width * height; i++)
+        U[i * MULTI_LANES + k] = values[i];
+}
+
+/* Copy the lane `k` of `U` in the `width x height` grid `values`.
+ */
+void multi_store(double* U, unsigned int width, unsigned int height, int k, FLT* values) {
+    #pragma omp parallel for schedule(static)
+    for(size_t i=0; i < (size_t) width * height; i++)
+        values[i] = U[i * MULTI_LANES + k];
+}
+
+/* Compute the Laplace equation on the `nproblems` grids of `problems` (each of them `width x height`, with its boundary conditions), as `laplace()` would do for each of them.
+ * The number of iterations of each problem is stored in `iterations`.
+ * Returns the number of sweeps (over `MULTI_LANES` problems), or -1 on error.
+ * max_iter: maximal number of iteration (of each problem)
+ * threshold: minimal change
+ */
+int laplace_multi(FLT** problems, int nproblems, unsigned int width, double dx, unsigned int height, double dy, int max_iter, double threshold, int* iterations) {
+    double* U = grid_alloc(width, height, MULTI_LANES * sizeof(double));
+    double* tmp = grid_alloc(width, height, MULTI_LANES * sizeof(double));
+    if(U == NULL || tmp == NULL) {
+        grid_free(U);
+        grid_free(tmp);
+        return -1;
+    }
+
+    double cx = dy * dy / (2 * dx * dx + 2 * dy * dy), cy = dx * dx / (2 * dx * dx + 2 * dy * dy);
+    int lanes[MULTI_LANES], start[MULTI_LANES]; // problem in each lane, and sweep at which it was loaded
+    unsigned int active = 0;
+    int next = 0, sweeps = 0;
+
+    /* fill the lanes (both buffers hold the boundary conditions) */
+    for(int k=0; k < MULTI_LANES && next < nproblems; k++, next++) {
+        multi_load(U, width, height, k, problems[next]);
+        multi_load(tmp, width, height, k, problems[next]);
+        lanes[k] = next;
+        start[k] = 0;
+        active |= 1u << k;
+    }
+
+    while(active != 0) {
+        double errors[MULTI_LANES] = {0};
+
+        #pragma omp parallel for reduction(max:errors[:MULTI_LANES]) schedule(static)
+        for(int y=1; y < (height - 1); y++) {
+            jacobi_multi(&tmp[((size_t) y * width + 1) * MULTI_LANES], &U[((size_t) y * width + 1) * MULTI_LANES], width, width - 2, cx, cy, active, errors);
+        }
+
+        double* swap = U;
+        U = tmp;
+        tmp = swap;
+        sweeps++;
+
+        /* retire the problems which converged, and replace them with the next ones */
+        for(int k=0; k < MULTI_LANES; k++) {
+            if(!((active >> k) & 1) || (errors[k] >= threshold && sweeps - start[k] < max_iter))
+                continue;
+
+            iterations[lanes[k]] = sweeps - start[k];
+            multi_store(U, width, height, k, problems[lanes[k]]);
+            active &= ~(1u << k);
+
+            if(next < nproblems) {
+                multi_load(U, width, height, k, problems[next]);
+                multi_load(tmp, width, height, k, problems[next]);
+                lanes[k] = next++;
+                start[k] = sweeps;
+                active |= 1u << k;
+            }
+        }
+    }
+
+    grid_free(U);
+    grid_free(tmp);
+    return sweeps;
+}
+
+#endif // MULTI_H
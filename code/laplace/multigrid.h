@@ -0,0 +1,322 @@
+#ifndef MULTIGRID_H
+#define MULTIGRID_H
+
+/* Geometric multigrid solver for the Laplace equation (Dirichlet boundary conditions).
+ *
+ * The equation is written as `L u = f`, where `L u = (2/dx^2 + 2/dy^2) u - (u_east + u_west) / dx^2 - (u_north + u_south) / dy^2` is the 5-point operator.
+ * The grids are coarsened by a factor (roughly) 2 in each direction until they are too small.
+ * Since the size of the grids are arbitrary, the coarse grids cover the same domain with a slightly different ratio,
+ * and the transfers between grids are done by bilinear interpolation (prolongation) and its (normalized) transpose (restriction, i.e., full weighting when the ratio is exactly 2).
+ *
+ * Requires `common.h` (for `FLT` and `ffmax()`).
+ */
+
+#include <math.h>
+#include <stdlib.h>
+
+#define MG_PRE_SMOOTH 2
+#define MG_POST_SMOOTH 2
+#define MG_COARSEST 5 // a grid with less points than that in one direction is not coarsened anymore
+#define MG_COARSEST_SWEEPS 50
+#define MG_MIN_PARALLEL 4096 // do not start threads on grids with less points than that
+
+typedef struct Level_ {
+    /* A level of the multigrid hierarchy.
+     * All the arrays are `width x height`, and include the boundary.
+     */
+    unsigned int width, height;
+    FLT dx, dy;
+    FLT* u; // solution (on the finest level) or correction (on the coarser ones)
+    FLT* f; // right-hand side
+    FLT* r; // residual
+} Level;
+
+typedef struct Multigrid_ {
+    int nlevels;
+    Level* levels; // `levels[0]` is the finest
+} Multigrid;
+
+void mg_delete(Multigrid* mg) {
+    if(mg != NULL) {
+        for(int l=0; l < mg->nlevels; l++) {
+            if(l > 0)
+                free(mg->levels[l].u);
+            free(mg->levels[l].f);
+            free(mg->levels[l].r);
+        }
+
+        free(mg->levels);
+        free(mg);
+    }
+}
+
+/* Create the hierarchy of grids, the finest being `width x height` and using `U` as solution.
+ * Returns NULL on error.
+ */
+Multigrid* mg_new(FLT* U, unsigned int width, FLT dx, unsigned int height, FLT dy) {
+    Multigrid* mg = malloc(sizeof(Multigrid));
+    if(mg == NULL)
+        return NULL;
+
+    /* count levels */
+    mg->nlevels = 1;
+    for(unsigned int w=width, h=height; w >= 2 * MG_COARSEST - 1 && h >= 2 * MG_COARSEST - 1; w = (w - 1) / 2 + 1, h = (h - 1) / 2 + 1)
+        mg->nlevels++;
+
+    mg->levels = calloc(mg->nlevels, sizeof(Level));
+    if(mg->levels == NULL) {
+        free(mg);
+        return NULL;
+    }
+
+    for(int l=0; l < mg->nlevels; l++) {
+        Level* level = &mg->levels[l];
+        if(l == 0) {
+            level->width = width;
+            level->height = height;
+            level->dx = dx;
+            level->dy = dy;
+            level->u = U;
+        } else {
+            Level* finer = &mg->levels[l - 1];
+            level->width = (finer->width - 1) / 2 + 1;
+            level->height = (finer->height - 1) / 2 + 1;
+            level->dx = finer->dx * (finer->width - 1) / (level->width - 1);
+            level->dy = finer->dy * (finer->height - 1) / (level->height - 1);
+            level->u = calloc(level->width * level->height, sizeof(FLT));
+        }
+
+        level->f = calloc(level->width * level->height, sizeof(FLT));
+        level->r = calloc(level->width * level->height, sizeof(FLT));
+
+        if(level->u == NULL || level->f == NULL || level->r == NULL) {
+            mg->nlevels = l + 1;
+            mg_delete(mg);
+            return NULL;
+        }
+    }
+
+    return mg;
+}
+
+/* Perform `nsweeps` red-black Gauss-Seidel sweeps on `L u = f`.
+ */
+void mg_smooth(Level* level, int nsweeps) {
+    unsigned int width = level->width, height = level->height;
+    FLT *u = level->u, *f = level->f;
+    FLT cx = 1 / (level->dx * level->dx), cy = 1 / (level->dy * level->dy), diag = 2 * cx + 2 * cy;
+
+    #pragma omp parallel if(width * height > MG_MIN_PARALLEL)
+    for(int sweep=0; sweep < nsweeps; sweep++) {
+        for(int color=0; color < 2; color++) {
+            #pragma omp for
+            for(int y=1; y < (height - 1); y++) {
+                #pragma omp simd
+                for(int x=1 + (1 + y + color) % 2; x < (width - 1); x += 2) {
+                    int i = y * width + x;
+                    u[i] = (f[i] + cx * (u[i+1] + u[i-1]) + cy * (u[i+width] + u[i-width])) / diag;
+                }
+            }
+        }
+    }
+}
+
+/* Compute the residual, `r = f - L u`, and return its maximal value divided by the diagonal of `L`.
+ * The latter is the change that a jacobi iteration would make, so that it can be compared with the threshold of the other solvers.
+ */
+FLT mg_residual(Level* level) {
+    unsigned int width = level->width, height = level->height;
+    FLT *u = level->u, *f = level->f, *r = level->r;
+    FLT cx = 1 / (level->dx * level->dx), cy = 1 / (level->dy * level->dy), diag = 2 * cx + 2 * cy;
+    FLT error = .0f;
+
+    #pragma omp parallel for reduction(max:error) if(width * height > MG_MIN_PARALLEL)
+    for(int y=1; y < (height - 1); y++) {
+        for(int x=1; x < (width - 1); x++) {
+            int i = y * width + x;
+            r[i] = f[i] - diag * u[i] + cx * (u[i+1] + u[i-1]) + cy * (u[i+width] + u[i-width]);
+            error = ffmax(error, fabs(r[i]));
+        }
+    }
+
+    return error / diag;
+}
+
+/* Get the first and last fine point (included) in the support of the coarse point `I`, and the scaling between the two grids.
+ */
+void mg_support(unsigned int I, unsigned int fine, unsigned int coarse, int* first, int* last, FLT* scale) {
+    *scale = (FLT) (coarse - 1) / (fine - 1);
+    *first = (int) floor((I - 1) / *scale) + 1;
+    *last = (int) ceil((I + 1) / *scale) - 1;
+    if(*first < 0)
+        *first = 0;
+    if(*last > (int) fine - 1)
+        *last = fine - 1;
+}
+
+/* Restrict `fine` (a `fw x fh` array) into the interior points of `coarse` (a `cw x ch` array).
+ * Each coarse point is the average of the fine points around it, weighted by the bilinear interpolation functions.
+ */
+void mg_restrict(FLT* fine, unsigned int fw, unsigned int fh, FLT* coarse, unsigned int cw, unsigned int ch) {
+    #pragma omp parallel for if(fw * fh > MG_MIN_PARALLEL)
+    for(unsigned int J=1; J < (ch - 1); J++) {
+        int y0, y1, x0, x1;
+        FLT sy, sx;
+        mg_support(J, fh, ch, &y0, &y1, &sy);
+
+        for(unsigned int I=1; I < (cw - 1); I++) {
+            mg_support(I, fw, cw, &x0, &x1, &sx);
+            FLT sum = .0f, weights = .0f;
+
+            for(int y=y0; y <= y1; y++) {
+                FLT wy = 1 - fabs(y * sy - J);
+                for(int x=x0; x <= x1; x++) {
+                    FLT w = wy * (1 - fabs(x * sx - I));
+                    sum += w * fine[y * fw + x];
+                    weights += w;
+                }
+            }
+
+            coarse[J * cw + I] = sum / weights;
+        }
+    }
+}
+
+/* Bilinear interpolation of `coarse` (a `cw x ch` array) at the points of `fine` (a `fw x fh` array).
+ * If `add` is set, the interpolated values are added to the interior points of `fine`, otherwise they replace them.
+ */
+void mg_prolongate(FLT* coarse, unsigned int cw, unsigned int ch, FLT* fine, unsigned int fw, unsigned int fh, int add) {
+    FLT sx = (FLT) (cw - 1) / (fw - 1), sy = (FLT) (ch - 1) / (fh - 1);
+
+    #pragma omp parallel for if(fw * fh > MG_MIN_PARALLEL)
+    for(unsigned int y=1; y < (fh - 1); y++) {
+        FLT Y = y * sy;
+        unsigned int J = (unsigned int) Y;
+        if(J > ch - 2)
+            J = ch - 2;
+        FLT ty = Y - J;
+
+        for(unsigned int x=1; x < (fw - 1); x++) {
+            FLT X = x * sx;
+            unsigned int I = (unsigned int) X;
+            if(I > cw - 2)
+                I = cw - 2;
+            FLT tx = X - I;
+
+            FLT value = (1 - ty) * ((1 - tx) * coarse[J * cw + I] + tx * coarse[J * cw + I + 1]) + ty * ((1 - tx) * coarse[(J + 1) * cw + I] + tx * coarse[(J + 1) * cw + I + 1]);
+            if(add)
+                fine[y * fw + x] += value;
+            else
+                fine[y * fw + x] = value;
+        }
+    }
+}
+
+/* Linear interpolation of the boundary of `fine` on the boundary of `coarse`.
+ */
+void mg_boundaries(Level* fine, Level* coarse) {
+    unsigned int fw = fine->width, fh = fine->height, cw = coarse->width, ch = coarse->height;
+    FLT sx = (FLT) (fw - 1) / (cw - 1), sy = (FLT) (fh - 1) / (ch - 1);
+
+    for(unsigned int I=0; I < cw; I++) {
+        unsigned int i = (unsigned int) (I * sx);
+        if(i > fw - 2)
+            i = fw - 2;
+        FLT t = I * sx - i;
+        coarse->u[I] = (1 - t) * fine->u[i] + t * fine->u[i + 1];
+        coarse->u[(ch - 1) * cw + I] = (1 - t) * fine->u[(fh - 1) * fw + i] + t * fine->u[(fh - 1) * fw + i + 1];
+    }
+
+    for(unsigned int J=0; J < ch; J++) {
+        unsigned int j = (unsigned int) (J * sy);
+        if(j > fh - 2)
+            j = fh - 2;
+        FLT t = J * sy - j;
+        coarse->u[J * cw] = (1 - t) * fine->u[j * fw] + t * fine->u[(j + 1) * fw];
+        coarse->u[J * cw + cw - 1] = (1 - t) * fine->u[j * fw + fw - 1] + t * fine->u[(j + 1) * fw + fw - 1];
+    }
+}
+
+/* Perform a V-cycle, starting from level `l`.
+ * The coarser levels solve for the correction, with homogeneous boundary conditions.
+ */
+void mg_vcycle(Multigrid* mg, int l) {
+    Level* level = &mg->levels[l];
+
+    if(l == mg->nlevels - 1) {
+        mg_smooth(level, MG_COARSEST_SWEEPS);
+        return;
+    }
+
+    Level* coarse = &mg->levels[l + 1];
+
+    mg_smooth(level, MG_PRE_SMOOTH);
+    mg_residual(level);
+    mg_restrict(level->r, level->width, level->height, coarse->f, coarse->width, coarse->height);
+
+    for(unsigned int i=0; i < coarse->width * coarse->height; i++)
+        coarse->u[i] = .0f;
+
+    mg_vcycle(mg, l + 1);
+
+    mg_prolongate(coarse->u, coarse->width, coarse->height, level->u, level->width, level->height, 1);
+    mg_smooth(level, MG_POST_SMOOTH);
+}
+
+/* Full multigrid (FMG) start: the problem is solved on the coarsest level, then the solution is interpolated on the finer level, where a V-cycle is performed, and so all.
+ * Since the coarse levels contain the solution (and not a correction), they use the boundary conditions of the finest level.
+ */
+void mg_fmg(Multigrid* mg) {
+    for(int l=1; l < mg->nlevels; l++) {
+        Level* fine = &mg->levels[l - 1];
+        Level* coarse = &mg->levels[l];
+
+        mg_boundaries(fine, coarse);
+        mg_restrict(fine->f, fine->width, fine->height, coarse->f, coarse->width, coarse->height);
+    }
+
+    mg_smooth(&mg->levels[mg->nlevels - 1], MG_COARSEST_SWEEPS);
+
+    for(int l=mg->nlevels - 2; l >= 0; l--) {
+        Level* fine = &mg->levels[l];
+        Level* coarse = &mg->levels[l + 1];
+
+        mg_prolongate(coarse->u, coarse->width, coarse->height, fine->u, fine->width, fine->height, 0);
+        mg_vcycle(mg, l);
+    }
+}
+
+/* Compute the Laplace equation with multigrid, until the maximal change (that a jacobi iteration would make) is lower than `threshold` or the number of V-cycles exceed `max_iter`.
+ * The first and last row/column are used to get the values for the Dirichlet (i.e., fixed value) boundary conditions.
+ * The first V-cycles are performed in a full multigrid (FMG) start (see `mg_fmg()`).
+ * Returns the number of V-cycles (including the one of the FMG start on the finest level), or -1 on error.
+ * U: function
+ * max_iter: maximal number of V-cycles
+ * threshold: minimal change
+ */
+int laplace_multigrid(FLT* U, unsigned int width, FLT dx, unsigned int height, FLT dy, int max_iter, FLT threshold) {
+    if(U != NULL) {
+        Multigrid* mg = mg_new(U, width, dx, height, dy);
+        if(mg == NULL)
+            return -1;
+
+        printf("using %d levels\n", mg->nlevels);
+
+        mg_fmg(mg);
+
+        FLT error = mg_residual(&mg->levels[0]);
+        int iter;
+
+        for(iter=1; iter < max_iter && error >= threshold; iter++) {
+            mg_vcycle(mg, 0);
+            error = mg_residual(&mg->levels[0]);
+        }
+
+        printf("final error=%f\n", error);
+
+        mg_delete(mg);
+        return iter;
+    }
+}
+
+#endif // MULTIGRID_H
@@ -0,0 +1,280 @@
+#ifndef OUTOFCORE_H
+#define OUTOFCORE_H
+
+/* Out-of-core jacobi: the grid lives in a file (in the format of `field.h`), and only a few bands of rows are in memory at a time, so that the grid can be larger than the memory.
+ *
+ * A pass goes through the grid from top to bottom, one band of `rows` rows at a time.
+ * Each band is read together with a margin of `depth` rows on each side (its "window"), on which `depth` jacobi iterations are performed: as in `laplace_tiles()`, the part of the window that is computed shrinks by one row at each iteration, so that the band itself is exact after `depth` iterations.
+ * Thus, a pass performs `depth` iterations while the grid is read and written only once (at the cost of computing `2 * depth` more rows per band).
+ * The passes are pipelined over three stages, as in `batch.h`:
+ * 1. a thread reads the window of the next band (read-ahead),
+ * 2. the OMP threads compute the current band,
+ * 3. another thread writes the previous band back in the file (write-behind).
+ * The values are updated in place: the window of the next band starts `depth` rows before the end of the current band, which is only written once that window is read, and the previous band ends before it (since `rows >= depth`).
+ * The memory is bounded by four windows (the one being read, the two of the computation, and the one being written), of `(rows + 2 * depth) x width` values each, so `rows` is given by the memory cap (see `ooc_rows()`).
+ * At the end of each pass, the number of iterations and the error are stored in the header of the file: if the program is stopped during a pass, the file contains a mix of two iterations, which is still a valid initial guess for the next run.
+ *
+ * Requires `common.h`, `simd.h` (for `JACOBI_ROW()`), `placement.h` (for `grid_alloc()`) and `field.h`.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#define OOC_WINDOWS 4 // number of windows in memory (see above)
+
+/* Transfer of a window between the file and the memory, performed by a thread */
+typedef struct OocTransfer_ {
+    int fd;
+    int write; // 1 to write `buffer` in the file, 0 to read it
+    FLT* buffer;
+    size_t size; // (in bytes)
+    off_t offset;
+    int status; // 0 on success, -1 on error
+} OocTransfer;
+
+/* (thread) perform `transfer`, with as many calls to `pread()` or `pwrite()` as needed.
+ */
+void* ooc_transfer(void* arg) {
+    OocTransfer* transfer = arg;
+    char* buffer = (char*) transfer->buffer;
+    size_t done = 0;
+
+    transfer->status = 0;
+    while(done < transfer->size) {
+        ssize_t n = transfer->write ? pwrite(transfer->fd, buffer + done, transfer->size - done, transfer->offset + done) : pread(transfer->fd, buffer + done, transfer->size - done, transfer->offset + done);
+        if(n <= 0) {
+            transfer->status = -1;
+            break;
+        }
+        done += n;
+    }
+
+    /* the written pages are not needed anymore during this pass: start writing them to disk, so that the page cache does not fill up with the grid */
+    if(transfer->write)
+        posix_fadvise(transfer->fd, transfer->offset, transfer->size, POSIX_FADV_DONTNEED);
+
+    return NULL;
+}
+
+/* Run `transfer` in a new thread (stored in `thread`), or directly if the thread cannot be created.
+ * Returns 1 if a thread was created (and should be joined), 0 otherwise.
+ */
+int ooc_start(pthread_t* thread, OocTransfer* transfer) {
+    if(pthread_create(thread, NULL, ooc_transfer, transfer) == 0)
+        return 1;
+
+    ooc_transfer(transfer);
+    return 0;
+}
+
+/* Get the number of rows of the bands, so that the windows fit in `memory` bytes, for a `width x height` grid and `depth` iterations per pass.
+ * Returns 0 if `memory` is too small (the bands need at least `depth` rows).
+ */
+unsigned int ooc_rows(size_t memory, unsigned int width, unsigned int height, int depth) {
+    size_t window = memory / OOC_WINDOWS / ((size_t) width * sizeof(FLT));
+    if(window < 3 * (size_t) depth)
+        return 0;
+
+    size_t rows = window - 2 * depth;
+    return (rows < height - 2) ? rows : height - 2;
+}
+
+/* Create the file at `path` for a `width x height` grid, with the boundary conditions given by the input image `in`, and zero elsewhere.
+ * The boundaries are written with `pwrite()` (the file is sparse, and is not mapped, so that only the pages of the boundaries are in memory).
+ * Returns 0 on success, -1 on error.
+ */
+int ooc_create(const char* path, Image* in, unsigned int width, unsigned int height) {
+    FieldHeader header = {.value_size = sizeof(FLT), .width = width, .height = height, .iterations = 0, .error = NAN};
+    void* map = field_create(path, &header);
+    FLT* row = malloc(width * sizeof(FLT));
+    int fd = (map != NULL) ? open(path, O_RDWR) : -1, status = (row != NULL && fd >= 0) ? 0 : -1;
+    if(map != NULL)
+        field_close(map, &header);
+
+    for(int side=TOP; side <= BOTTOM && status == 0; side++) {
+        off_t offset = header.offset + (off_t) ((side == TOP) ? 0 : height - 1) * width * sizeof(FLT);
+        for(unsigned int j=0; j < width; j++)
+            row[j] = boundary_value(in, side, j, width);
+
+        if(pwrite(fd, row, width * sizeof(FLT), offset) != width * sizeof(FLT))
+            status = -1;
+    }
+
+    for(unsigned int j=1; j < height - 1 && status == 0; j++) {
+        off_t offset = header.offset + (off_t) j * width * sizeof(FLT);
+        FLT left = boundary_value(in, LEFT, j, height), right = boundary_value(in, RIGHT, j, height);
+
+        if(pwrite(fd, &left, sizeof(FLT), offset) != sizeof(FLT) || pwrite(fd, &right, sizeof(FLT), offset + (width - 1) * sizeof(FLT)) != sizeof(FLT))
+            status = -1;
+    }
+
+    if(fd >= 0)
+        close(fd);
+    free(row);
+    return status;
+}
+
+/* Perform `steps` jacobi iterations on the window `a` (rows `w0` to `w1` of the grid, `b` being a buffer of the same size), for the band of rows `y0` to `y1`.
+ * Returns the window that contains the result, and store the maximal change of each iteration on the band in `errors`.
+ */
+FLT* ooc_band(FLT* a, FLT* b, unsigned int width, FLT dx, unsigned int height, FLT dy, int w0, int w1, int y0, int y1, int steps, FLT* errors) {
+    FLT cx = dy * dy / (2 * dx * dx + 2 * dy * dy), cy = dx * dx / (2 * dx * dx + 2 * dy * dy);
+    memcpy(b, a, (size_t) (w1 - w0) * width * sizeof(FLT)); // (for the boundaries)
+
+    for(int k=0; k < steps; k++) {
+        int ry0 = (int) fmax(y0 - steps + k + 1, 1), ry1 = (int) fmin(y1 + steps - k - 1, height - 1);
+        FLT error = .0f;
+
+        #pragma omp parallel for reduction(max:error) schedule(static)
+        for(int y=ry0; y < ry1; y++) {
+            FLT change = JACOBI_ROW(&b[(size_t) (y - w0) * width + 1], &a[(size_t) (y - w0) * width + 1], NULL, width, width - 2, cx, cy);
+            if(y >= y0 && y < y1)
+                error = ffmax(error, change);
+        }
+
+        errors[k] = ffmax(errors[k], error);
+
+        FLT* swap = a;
+        a = b;
+        b = swap;
+    }
+
+    return a;
+}
+
+/* Compute the Laplace equation on the grid of the file `fd` (described by `header`), until the maximal change of the last iteration of a pass is lower than `threshold` or the number of iterations exceeds `max_iter`.
+ * The bands have `rows` rows (see `ooc_rows()`), and each pass performs `depth` iterations.
+ * Thus, the solver stops at most `depth - 1` iterations after the threshold is reached.
+ * Returns the number of iterations, or -1 on error.
+ */
+int laplace_ooc(int fd, FieldHeader* header, FLT dx, FLT dy, int max_iter, FLT threshold, unsigned int rows, int depth) {
+    unsigned int width = header->width, height = header->height;
+    int nbands = (height - 2 + rows - 1) / rows;
+    size_t row_size = (size_t) width * sizeof(FLT);
+
+    FLT* windows[OOC_WINDOWS];
+    FLT* errors = malloc(depth * sizeof(FLT));
+    int allocated = (errors != NULL);
+    for(int i=0; i < OOC_WINDOWS; i++) {
+        windows[i] = grid_alloc(width, rows + 2 * depth, sizeof(FLT));
+        allocated = allocated && windows[i] != NULL;
+    }
+
+    if(!allocated) {
+        for(int i=0; i < OOC_WINDOWS; i++)
+            grid_free(windows[i]);
+        free(errors);
+        return -1;
+    }
+
+    posix_fadvise(fd, header->offset, (size_t) height * row_size, POSIX_FADV_SEQUENTIAL);
+
+    FLT error = .0f;
+    int iter, status = 0;
+    double waiting = .0;
+    struct timespec start, wait;
+    timer_start(&start);
+
+    for(iter=0; iter < max_iter && status == 0; ) {
+        int steps = (int) fmin(depth, max_iter - iter);
+        for(int k=0; k < steps; k++)
+            errors[k] = .0f;
+
+        /* roles of the windows: `next` is being read, `a` and `b` are used by the computation, and `written` is being written */
+        FLT *next = windows[0], *a = windows[1], *b = windows[2], *written = windows[3];
+        pthread_t reader, writer;
+        OocTransfer read_transfer = {.fd = fd, .write = 0}, write_transfer = {.fd = fd, .write = 1};
+        int reading = 0, writing = 0;
+
+        /* window of the first band */
+        read_transfer.buffer = next;
+        read_transfer.size = (size_t) fmin(1 + rows + steps, height) * row_size;
+        read_transfer.offset = header->offset;
+        ooc_transfer(&read_transfer);
+        status = read_transfer.status;
+
+        for(int band=0; band < nbands && status == 0; band++) {
+            int y0 = 1 + band * rows, y1 = (int) fmin(y0 + rows, height - 1);
+            int w0 = (int) fmax(y0 - steps, 0), w1 = (int) fmin(y1 + steps, height);
+
+            FLT* swap = a;
+            a = next;
+            next = swap;
+
+            /* read-ahead of the next window (which starts `steps` rows before the end of this band, still unchanged in the file) */
+            if(band + 1 < nbands) {
+                int n0 = y1 - steps, n1 = (int) fmin(y1 + rows + steps, height);
+                read_transfer.buffer = next;
+                read_transfer.size = (size_t) (n1 - n0) * row_size;
+                read_transfer.offset = header->offset + (off_t) n0 * row_size;
+                reading = ooc_start(&reader, &read_transfer);
+            }
+
+            FLT* result = ooc_band(a, b, width, dx, height, dy, w0, w1, y0, y1, steps, errors);
+
+            timer_start(&wait);
+            if(reading)
+                pthread_join(reader, NULL);
+            if(writing)
+                pthread_join(writer, NULL);
+            waiting += timer_stop(&wait);
+            reading = writing = 0;
+
+            if(read_transfer.status != 0 || write_transfer.status != 0) {
+                status = -1;
+                break;
+            }
+
+            /* write-behind of this band (the window which holds the result is the one written, the other one is reused) */
+            if(result == a) {
+                a = written;
+                written = result;
+            } else {
+                b = written;
+                written = result;
+            }
+
+            write_transfer.buffer = &written[(size_t) (y0 - w0) * width];
+            write_transfer.size = (size_t) (y1 - y0) * row_size;
+            write_transfer.offset = header->offset + (off_t) y0 * row_size;
+            writing = ooc_start(&writer, &write_transfer);
+        }
+
+        timer_start(&wait);
+        if(writing)
+            pthread_join(writer, NULL);
+        waiting += timer_stop(&wait);
+        if(write_transfer.status != 0)
+            status = -1;
+
+        iter += steps;
+        error = errors[steps - 1];
+
+        header->iterations += steps;
+        header->error = error;
+        if(pwrite(fd, header, sizeof(FieldHeader), 0) != sizeof(FieldHeader))
+            status = -1;
+
+        printf("pass: iteration %d, error=%f\n", iter, error);
+
+        if(error < threshold)
+            break;
+    }
+
+    double elapsed = timer_stop(&start);
+    printf("final error=%f\n", error);
+    printf("waiting for the disk = %.3f secs (%.1f%%)\n", waiting, (elapsed > 0) ? 100 * waiting / elapsed : .0);
+
+    for(int i=0; i < OOC_WINDOWS; i++)
+        grid_free(windows[i]);
+    free(errors);
+
+    return (status == 0) ? iter : -1;
+}
+
+#endif // OUTOFCORE_H
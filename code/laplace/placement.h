@@ -0,0 +1,218 @@
+#ifndef PLACEMENT_H
+#define PLACEMENT_H
+
+/* NUMA-aware allocation of the grids, and pinning of the threads.
+ *
+ * On a machine with several NUMA nodes (e.g., sockets), a page of memory is placed on the node of the thread that writes it first ("first touch"), and is then slower to access from the other nodes.
+ * Thus, the grids are allocated with `grid_alloc()`, which zeroes them by rows, with the same static partition (`schedule(static)` over `1 <= y < height - 1`) as the loops of the solvers, so that each thread mostly accesses pages of its own node.
+ * The policy is selected with `placement_select()`:
+ * - `first-touch` (default): as described above,
+ * - `interleave`: the pages are spread round-robin over all the nodes (which evens out the bandwidth when the accesses do not follow the partition),
+ * - `bind`: the rows of each thread are bound to the node of that thread (which, contrary to first touch, also holds when the pages are swapped out or migrated).
+ * This only works if the threads do not move, thus `placement_pin()` pins each OMP thread to a CPU.
+ *
+ * The system calls are used directly (with the constants of `numaif.h` defined below), so that neither libnuma nor its headers are needed.
+ * The memory itself comes from `../arena.h` (with huge pages, the placement is done by blocks of 2 MiB).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <omp.h>
+#include "../arena.h"
+
+#define PLACEMENT_MAX_NODES 1024 // size of the node and CPU masks, in bits
+#define PLACEMENT_PAGES 1024 // number of pages queried at once by `grid_report()`
+
+/* Policies (`-n xx`), the names are given in the same order in `PLACEMENTS` */
+enum {
+    PLACEMENT_FIRST_TOUCH,
+    PLACEMENT_INTERLEAVE,
+    PLACEMENT_BIND
+};
+
+const char* PLACEMENTS[] = {"first-touch", "interleave", "bind", NULL};
+
+/* selected policy, and whether `grid_alloc()` reports the placement it achieved */
+int placement_policy = PLACEMENT_FIRST_TOUCH;
+int placement_verbose = 0;
+
+/* Select the placement policy `name` (NULL for the default), and whether to report the placement of each grid.
+ * Returns the name of the policy, or NULL if it does not exist.
+ */
+const char* placement_select(const char* name, int verbose) {
+    placement_verbose = verbose;
+    for(int i=0; PLACEMENTS[i] != NULL; i++) {
+        if(name == NULL || strcmp(PLACEMENTS[i], name) == 0) {
+            placement_policy = i;
+            return PLACEMENTS[i];
+        }
+    }
+
+    return NULL;
+}
+
+/* Pin each OMP thread to a CPU (the `i`-th thread to the `i`-th CPU on which the process is allowed to run, modulo their number).
+ * The threads of the OMP runtime are reused from one parallel region to the next, so that they stay pinned.
+ * Returns the number of CPUs, or -1 on error.
+ */
+int placement_pin() {
+    unsigned long allowed[PLACEMENT_MAX_NODES / (8 * sizeof(unsigned long))] = {0};
+    if(syscall(SYS_sched_getaffinity, 0, sizeof(allowed), allowed) < 0)
+        return -1;
+
+    int ncpus = 0;
+    for(int cpu=0; cpu < PLACEMENT_MAX_NODES; cpu++)
+        ncpus += (allowed[cpu / (8 * sizeof(unsigned long))] >> (cpu % (8 * sizeof(unsigned long)))) & 1;
+
+    int result = ncpus;
+
+    #pragma omp parallel reduction(min:result)
+    {
+        /* find the `i`-th allowed CPU */
+        int i = omp_get_thread_num() % ncpus, cpu;
+        for(cpu=0; cpu < PLACEMENT_MAX_NODES; cpu++) {
+            if((allowed[cpu / (8 * sizeof(unsigned long))] >> (cpu % (8 * sizeof(unsigned long)))) & 1 && i-- == 0)
+                break;
+        }
+
+        unsigned long mask[PLACEMENT_MAX_NODES / (8 * sizeof(unsigned long))] = {0};
+        mask[cpu / (8 * sizeof(unsigned long))] = 1ul << (cpu % (8 * sizeof(unsigned long)));
+        if(syscall(SYS_sched_setaffinity, 0, sizeof(mask), mask) < 0)
+            result = -1;
+    }
+
+    return result;
+}
+
+/* constants of the `SYS_mbind` and `SYS_get_mempolicy` system calls (from `numaif.h`) */
+#define MPOL_BIND 2
+#define MPOL_INTERLEAVE 3
+#define MPOL_F_MEMS_ALLOWED (1 << 2)
+
+/* Set the policy of the pages of `[start, end)`, with both ends rounded up to a page boundary (so that consecutive ranges cover each page once, a page shared by two ranges going to the first one): interleaved over all the nodes, or bound to the node of the calling thread.
+ * Returns 0 on success, -1 on error.
+ */
+int placement_mbind(char* start, char* end, int policy) {
+    size_t page = sysconf(_SC_PAGESIZE);
+    start = (char*) (((size_t) start + page - 1) / page * page);
+    end = (char*) (((size_t) end + page - 1) / page * page);
+    if(end <= start)
+        return 0;
+
+    unsigned long nodes[PLACEMENT_MAX_NODES / (8 * sizeof(unsigned long))] = {0};
+    if(policy == PLACEMENT_INTERLEAVE) {
+        if(syscall(SYS_get_mempolicy, NULL, nodes, PLACEMENT_MAX_NODES, NULL, MPOL_F_MEMS_ALLOWED) < 0)
+            return -1;
+    } else {
+        unsigned int cpu, node;
+        if(syscall(SYS_getcpu, &cpu, &node, NULL) < 0)
+            return -1;
+        nodes[node / (8 * sizeof(unsigned long))] = 1ul << (node % (8 * sizeof(unsigned long)));
+    }
+
+    /* (the kernel reads `maxnode - 1` bits) */
+    return (syscall(SYS_mbind, start, end - start, (policy == PLACEMENT_INTERLEAVE) ? MPOL_INTERLEAVE : MPOL_BIND, nodes, PLACEMENT_MAX_NODES + 1, 0) < 0) ? -1 : 0;
+}
+
+/* Zero the `width x height` values of `value_size` bytes in `values`, by rows, with the same static partition as the loops of the solvers (the first and last rows go with their neighbors), applying the selected policy.
+ * Returns 0 on success, -1 if the policy could not be applied (the values are zeroed anyway).
+ */
+int grid_touch(void* values, unsigned int width, unsigned int height, size_t value_size) {
+    size_t row = (size_t) width * value_size;
+    int result = 0;
+
+    if(placement_policy == PLACEMENT_INTERLEAVE)
+        result = placement_mbind(values, (char*) values + row * height, PLACEMENT_INTERLEAVE);
+
+    #pragma omp parallel reduction(min:result)
+    {
+        int first = -1, last = -1;
+
+        #pragma omp for schedule(static)
+        for(int y=1; y < (height - 1); y++) {
+            if(first < 0)
+                first = y;
+            last = y;
+        }
+
+        if(first >= 0) {
+            first = (first == 1) ? 0 : first;
+            last = (last == height - 2) ? height - 1 : last;
+
+            char* start = (char*) values + first * row;
+            char* end = (char*) values + (last + 1) * row;
+            if(placement_policy == PLACEMENT_BIND && placement_mbind(start, end, PLACEMENT_BIND) != 0)
+                result = -1;
+
+            memset(start, 0, end - start);
+        }
+    }
+
+    return result;
+}
+
+/* Print the number of pages of `values` (`width x height` values of `value_size` bytes) that are on each node.
+ */
+void grid_report(void* values, unsigned int width, unsigned int height, size_t value_size, const char* name) {
+    size_t page = sysconf(_SC_PAGESIZE);
+    size_t npages = ((size_t) width * height * value_size + page - 1) / page;
+    size_t counts[PLACEMENT_MAX_NODES + 1] = {0}; // (the last one counts the pages that are not present)
+    char* start = (char*) ((size_t) values / page * page);
+
+    void* pages[PLACEMENT_PAGES];
+    int status[PLACEMENT_PAGES];
+
+    for(size_t i=0; i < npages; i += PLACEMENT_PAGES) {
+        size_t n = (i + PLACEMENT_PAGES < npages) ? PLACEMENT_PAGES : npages - i;
+        for(size_t j=0; j < n; j++)
+            pages[j] = start + (i + j) * page;
+
+        /* (without target nodes, `move_pages()` only gives the node of each page) */
+        if(syscall(SYS_move_pages, 0, n, pages, NULL, status, 0) < 0) {
+            printf("%s: the placement of the pages is not available\n", name);
+            return;
+        }
+
+        for(size_t j=0; j < n; j++)
+            counts[(status[j] >= 0 && status[j] < PLACEMENT_MAX_NODES) ? status[j] : PLACEMENT_MAX_NODES]++;
+    }
+
+    printf("%s: %zu pages", name, npages);
+    for(int node=0; node <= PLACEMENT_MAX_NODES; node++) {
+        if(counts[node] > 0) {
+            if(node < PLACEMENT_MAX_NODES)
+                printf(", %.1f%% on node %d", 100. * counts[node] / npages, node);
+            else
+                printf(", %.1f%% not present", 100. * counts[node] / npages);
+        }
+    }
+    printf("\n");
+}
+
+/* Allocate a grid of `width x height` values of `value_size` bytes (with `arena_alloc()`, zeroed, and placed with the selected policy, see `grid_touch()`).
+ * Returns NULL on error.
+ */
+void* grid_alloc(unsigned int width, unsigned int height, size_t value_size) {
+    void* values = arena_alloc((size_t) width * height * value_size);
+    if(values == NULL)
+        return NULL;
+
+    if(grid_touch(values, width, height, value_size) != 0 && placement_verbose)
+        printf("error while applying the %s policy\n", PLACEMENTS[placement_policy]);
+
+    if(placement_verbose)
+        grid_report(values, width, height, value_size, "grid");
+
+    return values;
+}
+
+/* Free a grid obtained with `grid_alloc()` (it is kept by the arena, so that the next grid of the same size reuses it).
+ */
+void grid_free(void* values) {
+    arena_free(values);
+}
+
+#endif // PLACEMENT_H
@@ -0,0 +1,347 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+/* Hand-vectorized row kernels of the jacobi stencil, for SSE2, AVX2 and AVX-512, in single and double precision.
+ * The kernel is chosen at startup (see `simd_select()`), depending on what the CPU supports, so that the same executable uses the full vector width on every machine.
+ *
+ * A row kernel computes `out[x] = ax * (in[x+1] + in[x-1]) + ay * (in[x+width] + in[x-width])` for `0 <= x < n`, and returns the maximal value of `|out[x] - in[x]|`.
+ * If `rhs` is not `NULL`, `rhs[x]` is added to `out[x]` (before computing the change), which gives the source term of the Poisson equation (see `source.h`).
+ * The coefficients are scaled once by the caller (`ax = dy^2 / (2 dx^2 + 2 dy^2)` and `ay = dx^2 / (2 dx^2 + 2 dy^2)`), so that there is no division per point (which is by far the slowest operation of the update).
+ * All the kernels perform the same operations, in the same order, so that their results are identical.
+ * The remainder of the row (which is not a multiple of the vector width) is handled with masks for AVX2 and AVX-512, and with the scalar version for SSE2 (which has no masked loads).
+ *
+ * The interleaved kernels (`jacobi_multi_*()`) do the same on `MULTI_LANES` problems at once, stored with their `MULTI_LANES` values of each point next to each other (so that the neighbors are at `±MULTI_LANES` and `±MULTI_LANES * width`).
+ * Each point is then a full vector (of doubles), so that there are no unaligned loads or remainders.
+ * Only the lanes set in `active` are updated (the others are copied), and the change of each lane is accumulated in `errors`.
+ *
+ * The SSE2, AVX2 and AVX-512 kernels (and the cpuid dispatch) are only compiled on x86: elsewhere, `simd_select()` always selects the scalar kernels, which the compiler vectorizes for the target.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+#define MULTI_LANES 8 // number of problems of the interleaved kernels (one AVX-512 register of doubles)
+
+/* scalar */
+
+double jacobi_row_double_scalar(double* out, double* in, double* rhs, int width, int n, double ax, double ay) {
+    double error = .0;
+    for(int x=0; x < n; x++) {
+        out[x] = ax * (in[x+1] + in[x-1]) + ay * (in[x+width] + in[x-width]);
+        if(rhs != NULL)
+            out[x] += rhs[x];
+        error = fmax(error, fabs(out[x] - in[x]));
+    }
+    return error;
+}
+
+float jacobi_row_float_scalar(float* out, float* in, float* rhs, int width, int n, float ax, float ay) {
+    float error = .0f;
+    for(int x=0; x < n; x++) {
+        out[x] = ax * (in[x+1] + in[x-1]) + ay * (in[x+width] + in[x-width]);
+        if(rhs != NULL)
+            out[x] += rhs[x];
+        error = fmaxf(error, fabsf(out[x] - in[x]));
+    }
+    return error;
+}
+
+void jacobi_multi_scalar(double* out, double* in, int width, int n, double ax, double ay, unsigned int active, double* errors) {
+    for(int x=0; x < n * MULTI_LANES; x += MULTI_LANES) {
+        for(int k=0; k < MULTI_LANES; k++) {
+            if((active >> k) & 1) {
+                out[x+k] = ax * (in[x+k+MULTI_LANES] + in[x+k-MULTI_LANES]) + ay * (in[x+k+width*MULTI_LANES] + in[x+k-width*MULTI_LANES]);
+                errors[k] = fmax(errors[k], fabs(out[x+k] - in[x+k]));
+            } else
+                out[x+k] = in[x+k];
+        }
+    }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+
+/* SSE2 */
+
+__attribute__((target("sse2")))
+double jacobi_row_double_sse2(double* out, double* in, double* rhs, int width, int n, double ax, double ay) {
+    __m128d vax = _mm_set1_pd(ax), vay = _mm_set1_pd(ay), sign = _mm_set1_pd(-.0), error = _mm_setzero_pd();
+    int x = 0;
+
+    for(; x + 2 <= n; x += 2) {
+        __m128d center = _mm_loadu_pd(&in[x]);
+        __m128d horizontal = _mm_add_pd(_mm_loadu_pd(&in[x+1]), _mm_loadu_pd(&in[x-1]));
+        __m128d vertical = _mm_add_pd(_mm_loadu_pd(&in[x+width]), _mm_loadu_pd(&in[x-width]));
+        __m128d value = _mm_add_pd(_mm_mul_pd(vax, horizontal), _mm_mul_pd(vay, vertical));
+        if(rhs != NULL)
+            value = _mm_add_pd(value, _mm_loadu_pd(&rhs[x]));
+        _mm_storeu_pd(&out[x], value);
+        error = _mm_max_pd(error, _mm_andnot_pd(sign, _mm_sub_pd(value, center)));
+    }
+
+    double lanes[2];
+    _mm_storeu_pd(lanes, error);
+    return fmax(fmax(lanes[0], lanes[1]), jacobi_row_double_scalar(&out[x], &in[x], (rhs != NULL) ? &rhs[x] : NULL, width, n - x, ax, ay));
+}
+
+__attribute__((target("sse2")))
+float jacobi_row_float_sse2(float* out, float* in, float* rhs, int width, int n, float ax, float ay) {
+    __m128 vax = _mm_set1_ps(ax), vay = _mm_set1_ps(ay), sign = _mm_set1_ps(-.0f), error = _mm_setzero_ps();
+    int x = 0;
+
+    for(; x + 4 <= n; x += 4) {
+        __m128 center = _mm_loadu_ps(&in[x]);
+        __m128 horizontal = _mm_add_ps(_mm_loadu_ps(&in[x+1]), _mm_loadu_ps(&in[x-1]));
+        __m128 vertical = _mm_add_ps(_mm_loadu_ps(&in[x+width]), _mm_loadu_ps(&in[x-width]));
+        __m128 value = _mm_add_ps(_mm_mul_ps(vax, horizontal), _mm_mul_ps(vay, vertical));
+        if(rhs != NULL)
+            value = _mm_add_ps(value, _mm_loadu_ps(&rhs[x]));
+        _mm_storeu_ps(&out[x], value);
+        error = _mm_max_ps(error, _mm_andnot_ps(sign, _mm_sub_ps(value, center)));
+    }
+
+    float lanes[4];
+    _mm_storeu_ps(lanes, error);
+    return fmaxf(fmaxf(fmaxf(lanes[0], lanes[1]), fmaxf(lanes[2], lanes[3])), jacobi_row_float_scalar(&out[x], &in[x], (rhs != NULL) ? &rhs[x] : NULL, width, n - x, ax, ay));
+}
+
+__attribute__((target("sse2")))
+void jacobi_multi_sse2(double* out, double* in, int width, int n, double ax, double ay, unsigned int active, double* errors) {
+    __m128d vax = _mm_set1_pd(ax), vay = _mm_set1_pd(ay), sign = _mm_set1_pd(-.0), mask[MULTI_LANES / 2], error[MULTI_LANES / 2];
+    for(int j=0; j < MULTI_LANES / 2; j++) {
+        mask[j] = _mm_castsi128_pd(_mm_set_epi64x(-(long long) ((active >> (2*j + 1)) & 1), -(long long) ((active >> (2*j)) & 1)));
+        error[j] = _mm_loadu_pd(&errors[2*j]);
+    }
+
+    int stride = width * MULTI_LANES;
+    for(int x=0; x < n * MULTI_LANES; x += MULTI_LANES) {
+        for(int j=0; j < MULTI_LANES / 2; j++) {
+            double* p = &in[x + 2*j];
+            __m128d center = _mm_loadu_pd(p);
+            __m128d horizontal = _mm_add_pd(_mm_loadu_pd(p + MULTI_LANES), _mm_loadu_pd(p - MULTI_LANES));
+            __m128d vertical = _mm_add_pd(_mm_loadu_pd(p + stride), _mm_loadu_pd(p - stride));
+            __m128d value = _mm_add_pd(_mm_mul_pd(vax, horizontal), _mm_mul_pd(vay, vertical));
+            _mm_storeu_pd(&out[x + 2*j], _mm_or_pd(_mm_and_pd(mask[j], value), _mm_andnot_pd(mask[j], center)));
+            error[j] = _mm_max_pd(error[j], _mm_and_pd(mask[j], _mm_andnot_pd(sign, _mm_sub_pd(value, center))));
+        }
+    }
+
+    for(int j=0; j < MULTI_LANES / 2; j++)
+        _mm_storeu_pd(&errors[2*j], error[j]);
+}
+
+/* AVX2 */
+
+__attribute__((target("avx2")))
+double jacobi_row_double_avx2(double* out, double* in, double* rhs, int width, int n, double ax, double ay) {
+    __m256d vax = _mm256_set1_pd(ax), vay = _mm256_set1_pd(ay), sign = _mm256_set1_pd(-.0), error = _mm256_setzero_pd();
+
+    for(int x=0; x < n; x += 4) {
+        __m256d center, horizontal, vertical, value;
+
+        if(x + 4 <= n) {
+            center = _mm256_loadu_pd(&in[x]);
+            horizontal = _mm256_add_pd(_mm256_loadu_pd(&in[x+1]), _mm256_loadu_pd(&in[x-1]));
+            vertical = _mm256_add_pd(_mm256_loadu_pd(&in[x+width]), _mm256_loadu_pd(&in[x-width]));
+            value = _mm256_add_pd(_mm256_mul_pd(vax, horizontal), _mm256_mul_pd(vay, vertical));
+            if(rhs != NULL)
+                value = _mm256_add_pd(value, _mm256_loadu_pd(&rhs[x]));
+            _mm256_storeu_pd(&out[x], value);
+        } else { // remainder: the lanes after `n` are masked (and thus zero)
+            __m256i mask = _mm256_cmpgt_epi64(_mm256_set1_epi64x(n - x), _mm256_setr_epi64x(0, 1, 2, 3));
+            center = _mm256_maskload_pd(&in[x], mask);
+            horizontal = _mm256_add_pd(_mm256_maskload_pd(&in[x+1], mask), _mm256_maskload_pd(&in[x-1], mask));
+            vertical = _mm256_add_pd(_mm256_maskload_pd(&in[x+width], mask), _mm256_maskload_pd(&in[x-width], mask));
+            value = _mm256_add_pd(_mm256_mul_pd(vax, horizontal), _mm256_mul_pd(vay, vertical));
+            if(rhs != NULL)
+                value = _mm256_add_pd(value, _mm256_maskload_pd(&rhs[x], mask));
+            _mm256_maskstore_pd(&out[x], mask, value);
+        }
+
+        error = _mm256_max_pd(error, _mm256_andnot_pd(sign, _mm256_sub_pd(value, center)));
+    }
+
+    __m128d half = _mm_max_pd(_mm256_castpd256_pd128(error), _mm256_extractf128_pd(error, 1));
+    return _mm_cvtsd_f64(_mm_max_sd(half, _mm_unpackhi_pd(half, half)));
+}
+
+__attribute__((target("avx2")))
+float jacobi_row_float_avx2(float* out, float* in, float* rhs, int width, int n, float ax, float ay) {
+    __m256 vax = _mm256_set1_ps(ax), vay = _mm256_set1_ps(ay), sign = _mm256_set1_ps(-.0f), error = _mm256_setzero_ps();
+
+    for(int x=0; x < n; x += 8) {
+        __m256 center, horizontal, vertical, value;
+
+        if(x + 8 <= n) {
+            center = _mm256_loadu_ps(&in[x]);
+            horizontal = _mm256_add_ps(_mm256_loadu_ps(&in[x+1]), _mm256_loadu_ps(&in[x-1]));
+            vertical = _mm256_add_ps(_mm256_loadu_ps(&in[x+width]), _mm256_loadu_ps(&in[x-width]));
+            value = _mm256_add_ps(_mm256_mul_ps(vax, horizontal), _mm256_mul_ps(vay, vertical));
+            if(rhs != NULL)
+                value = _mm256_add_ps(value, _mm256_loadu_ps(&rhs[x]));
+            _mm256_storeu_ps(&out[x], value);
+        } else { // remainder: the lanes after `n` are masked (and thus zero)
+            __m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(n - x), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+            center = _mm256_maskload_ps(&in[x], mask);
+            horizontal = _mm256_add_ps(_mm256_maskload_ps(&in[x+1], mask), _mm256_maskload_ps(&in[x-1], mask));
+            vertical = _mm256_add_ps(_mm256_maskload_ps(&in[x+width], mask), _mm256_maskload_ps(&in[x-width], mask));
+            value = _mm256_add_ps(_mm256_mul_ps(vax, horizontal), _mm256_mul_ps(vay, vertical));
+            if(rhs != NULL)
+                value = _mm256_add_ps(value, _mm256_maskload_ps(&rhs[x], mask));
+            _mm256_maskstore_ps(&out[x], mask, value);
+        }
+
+        error = _mm256_max_ps(error, _mm256_andnot_ps(sign, _mm256_sub_ps(value, center)));
+    }
+
+    __m128 half = _mm_max_ps(_mm256_castps256_ps128(error), _mm256_extractf128_ps(error, 1));
+    half = _mm_max_ps(half, _mm_movehl_ps(half, half));
+    return _mm_cvtss_f32(_mm_max_ss(half, _mm_shuffle_ps(half, half, 1)));
+}
+
+__attribute__((target("avx2")))
+void jacobi_multi_avx2(double* out, double* in, int width, int n, double ax, double ay, unsigned int active, double* errors) {
+    __m256d vax = _mm256_set1_pd(ax), vay = _mm256_set1_pd(ay), sign = _mm256_set1_pd(-.0), mask[MULTI_LANES / 4], error[MULTI_LANES / 4];
+    for(int j=0; j < MULTI_LANES / 4; j++) {
+        mask[j] = _mm256_castsi256_pd(_mm256_cmpgt_epi64(_mm256_and_si256(_mm256_set1_epi64x(active >> (4*j)), _mm256_setr_epi64x(1, 2, 4, 8)), _mm256_setzero_si256()));
+        error[j] = _mm256_loadu_pd(&errors[4*j]);
+    }
+
+    int stride = width * MULTI_LANES;
+    for(int x=0; x < n * MULTI_LANES; x += MULTI_LANES) {
+        for(int j=0; j < MULTI_LANES / 4; j++) {
+            double* p = &in[x + 4*j];
+            __m256d center = _mm256_loadu_pd(p);
+            __m256d horizontal = _mm256_add_pd(_mm256_loadu_pd(p + MULTI_LANES), _mm256_loadu_pd(p - MULTI_LANES));
+            __m256d vertical = _mm256_add_pd(_mm256_loadu_pd(p + stride), _mm256_loadu_pd(p - stride));
+            __m256d value = _mm256_add_pd(_mm256_mul_pd(vax, horizontal), _mm256_mul_pd(vay, vertical));
+            _mm256_storeu_pd(&out[x + 4*j], _mm256_blendv_pd(center, value, mask[j]));
+            error[j] = _mm256_max_pd(error[j], _mm256_and_pd(mask[j], _mm256_andnot_pd(sign, _mm256_sub_pd(value, center))));
+        }
+    }
+
+    for(int j=0; j < MULTI_LANES / 4; j++)
+        _mm256_storeu_pd(&errors[4*j], error[j]);
+}
+
+/* AVX-512 */
+
+__attribute__((target("avx512f")))
+double jacobi_row_double_avx512(double* out, double* in, double* rhs, int width, int n, double ax, double ay) {
+    __m512d vax = _mm512_set1_pd(ax), vay = _mm512_set1_pd(ay), error = _mm512_setzero_pd();
+
+    for(int x=0; x < n; x += 8) {
+        __mmask8 mask = (n - x >= 8) ? 0xFF : (__mmask8) ((1u << (n - x)) - 1);
+        __m512d center = _mm512_maskz_loadu_pd(mask, &in[x]);
+        __m512d horizontal = _mm512_add_pd(_mm512_maskz_loadu_pd(mask, &in[x+1]), _mm512_maskz_loadu_pd(mask, &in[x-1]));
+        __m512d vertical = _mm512_add_pd(_mm512_maskz_loadu_pd(mask, &in[x+width]), _mm512_maskz_loadu_pd(mask, &in[x-width]));
+        __m512d value = _mm512_add_pd(_mm512_mul_pd(vax, horizontal), _mm512_mul_pd(vay, vertical));
+        if(rhs != NULL)
+            value = _mm512_add_pd(value, _mm512_maskz_loadu_pd(mask, &rhs[x]));
+        _mm512_mask_storeu_pd(&out[x], mask, value);
+        error = _mm512_mask_max_pd(error, mask, error, _mm512_abs_pd(_mm512_sub_pd(value, center)));
+    }
+
+    return _mm512_reduce_max_pd(error);
+}
+
+__attribute__((target("avx512f")))
+float jacobi_row_float_avx512(float* out, float* in, float* rhs, int width, int n, float ax, float ay) {
+    __m512 vax = _mm512_set1_ps(ax), vay = _mm512_set1_ps(ay), error = _mm512_setzero_ps();
+
+    for(int x=0; x < n; x += 16) {
+        __mmask16 mask = (n - x >= 16) ? 0xFFFF : (__mmask16) ((1u << (n - x)) - 1);
+        __m512 center = _mm512_maskz_loadu_ps(mask, &in[x]);
+        __m512 horizontal = _mm512_add_ps(_mm512_maskz_loadu_ps(mask, &in[x+1]), _mm512_maskz_loadu_ps(mask, &in[x-1]));
+        __m512 vertical = _mm512_add_ps(_mm512_maskz_loadu_ps(mask, &in[x+width]), _mm512_maskz_loadu_ps(mask, &in[x-width]));
+        __m512 value = _mm512_add_ps(_mm512_mul_ps(vax, horizontal), _mm512_mul_ps(vay, vertical));
+        if(rhs != NULL)
+            value = _mm512_add_ps(value, _mm512_maskz_loadu_ps(mask, &rhs[x]));
+        _mm512_mask_storeu_ps(&out[x], mask, value);
+        error = _mm512_mask_max_ps(error, mask, error, _mm512_abs_ps(_mm512_sub_ps(value, center)));
+    }
+
+    return _mm512_reduce_max_ps(error);
+}
+
+__attribute__((target("avx512f")))
+void jacobi_multi_avx512(double* out, double* in, int width, int n, double ax, double ay, unsigned int active, double* errors) {
+    __m512d vax = _mm512_set1_pd(ax), vay = _mm512_set1_pd(ay), error = _mm512_loadu_pd(errors);
+    __mmask8 mask = (__mmask8) active;
+
+    int stride = width * MULTI_LANES;
+    for(int x=0; x < n * MULTI_LANES; x += MULTI_LANES) {
+        __m512d center = _mm512_loadu_pd(&in[x]);
+        __m512d horizontal = _mm512_add_pd(_mm512_loadu_pd(&in[x + MULTI_LANES]), _mm512_loadu_pd(&in[x - MULTI_LANES]));
+        __m512d vertical = _mm512_add_pd(_mm512_loadu_pd(&in[x + stride]), _mm512_loadu_pd(&in[x - stride]));
+        __m512d value = _mm512_add_pd(_mm512_mul_pd(vax, horizontal), _mm512_mul_pd(vay, vertical));
+        _mm512_storeu_pd(&out[x], _mm512_mask_mov_pd(center, mask, value));
+        error = _mm512_mask_max_pd(error, mask, error, _mm512_abs_pd(_mm512_sub_pd(value, center)));
+    }
+
+    _mm512_storeu_pd(errors, error);
+}
+
+#endif // x86
+
+/* dispatch */
+
+double (*jacobi_row_double)(double*, double*, double*, int, int, double, double) = jacobi_row_double_scalar;
+float (*jacobi_row_float)(float*, float*, float*, int, int, float, float) = jacobi_row_float_scalar;
+void (*jacobi_multi)(double*, double*, int, int, double, double, unsigned int, double*) = jacobi_multi_scalar;
+
+/* Row kernel in the precision of `out` */
+#define JACOBI_ROW(out, in, rhs, width, n, ax, ay) _Generic((out), float*: jacobi_row_float, double*: jacobi_row_double)(out, in, rhs, width, n, ax, ay)
+
+/* Select the row kernels: `isa` is either "scalar", "sse2", "avx2", "avx512", or NULL to use the best one supported by the CPU (checked with cpuid).
+ * Returns the name of the selected instruction set, or NULL if `isa` is not known or not supported (on other architectures than x86, only "scalar" is).
+ */
+const char* simd_select(const char* isa) {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+
+    if(isa == NULL) {
+        if(__builtin_cpu_supports("avx512f"))
+            isa = "avx512";
+        else if(__builtin_cpu_supports("avx2"))
+            isa = "avx2";
+        else if(__builtin_cpu_supports("sse2"))
+            isa = "sse2";
+        else
+            isa = "scalar";
+    }
+#else
+    if(isa == NULL)
+        isa = "scalar";
+#endif
+
+    if(strcmp(isa, "scalar") == 0) {
+        jacobi_row_double = jacobi_row_double_scalar;
+        jacobi_row_float = jacobi_row_float_scalar;
+        jacobi_multi = jacobi_multi_scalar;
+    }
+#if defined(__x86_64__) || defined(__i386__)
+    else if(strcmp(isa, "sse2") == 0 && __builtin_cpu_supports("sse2")) {
+        jacobi_row_double = jacobi_row_double_sse2;
+        jacobi_row_float = jacobi_row_float_sse2;
+        jacobi_multi = jacobi_multi_sse2;
+    } else if(strcmp(isa, "avx2") == 0 && __builtin_cpu_supports("avx2")) {
+        jacobi_row_double = jacobi_row_double_avx2;
+        jacobi_row_float = jacobi_row_float_avx2;
+        jacobi_multi = jacobi_multi_avx2;
+    } else if(strcmp(isa, "avx512") == 0 && __builtin_cpu_supports("avx512f")) {
+        jacobi_row_double = jacobi_row_double_avx512;
+        jacobi_row_float = jacobi_row_float_avx512;
+        jacobi_multi = jacobi_multi_avx512;
+    }
+#endif
+    else
+        return NULL;
+
+    return isa;
+}
+
+#endif // SIMD_H
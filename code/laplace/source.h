@@ -0,0 +1,84 @@
+#ifndef SOURCE_H
+#define SOURCE_H
+
+/* Source term of the Poisson equation, `∇²u = f` (the Laplace equation being `f = 0`).
+ *
+ * With the 5-point stencil, the jacobi update becomes `u = (dy² (u[x+1] + u[x-1]) + dx² (u[y+1] + u[y-1]) - dx² dy² f) / (2 dx² + 2 dy²)`.
+ * Thus, `f` is scaled once by `-dx² dy² / (2 dx² + 2 dy²)` (see `source_rhs()`), and the result is added by the row kernels (the `rhs` of `simd.h`), so that a source only costs one more value read per point.
+ * `f` is given either by an image of any size (the value of a pixel being given by its red and blue components, as for the boundary conditions), or by a file in the format of `field.h`, both bilinearly interpolated on the grid.
+ * The values of `f` on the boundaries are not used.
+ *
+ * Requires `common.h`, `image_ppm.h`, `guess.h` (for `guess_file()`), `multigrid.h` (for `mg_prolongate()`) and `placement.h` (for `grid_alloc()`).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Set the interior of `f` (a `width x height` grid) to the values of the image at `path` (or of the file in the format of `field.h`, if it is not an image), bilinearly interpolated.
+ * Returns 0 on success, -1 on error.
+ */
+int source_load(FLT* f, unsigned int width, unsigned int height, const char* path) {
+    FILE* input = fopen(path, "r");
+    if(input == NULL)
+        return -1;
+
+    char magic[2] = {0};
+    int is_image = fread(magic, 1, 2, input) == 2 && magic[0] == 'P' && magic[1] == '6';
+    fclose(input);
+
+    if(!is_image)
+        return guess_file(f, width, height, path);
+
+    input = fopen(path, "r");
+    Image* in = (input != NULL) ? image_new_from_file(input) : NULL;
+    if(input != NULL)
+        fclose(input);
+    if(in == NULL || in->width < 2 || in->height < 2) {
+        if(in != NULL)
+            image_delete(in);
+        return -1;
+    }
+
+    FLT* values = malloc((size_t) in->width * in->height * sizeof(FLT));
+    if(values == NULL) {
+        image_delete(in);
+        return -1;
+    }
+
+    for(size_t i=0; i < (size_t) in->width * in->height; i++)
+        values[i] = (FLT) (in->pixels[3 * i + 0] - in->pixels[3 * i + 2]) / 255;
+
+    mg_prolongate(values, in->width, in->height, f, width, height, 0);
+    free(values);
+    image_delete(in);
+    return 0;
+}
+
+/* Get the term added by the row kernels for the source `f` (a `width x height` grid), in single (if `precision` is `SINGLE`) or double precision.
+ * The result is zero on the boundaries, and should be freed with `grid_free()`.
+ * Returns NULL on error.
+ */
+void* source_rhs(FLT* f, unsigned int width, double dx, unsigned int height, double dy, int precision) {
+    size_t size = (precision == SINGLE) ? sizeof(float) : sizeof(double);
+    double scale = -dx * dx * dy * dy / (2 * dx * dx + 2 * dy * dy);
+
+    void* rhs = grid_alloc(width, height, size); // (zeroed)
+    if(rhs == NULL)
+        return NULL;
+
+    #pragma omp parallel for schedule(static)
+    for(int y=1; y < (height - 1); y++) {
+        for(int x=1; x < (width - 1); x++) {
+            size_t i = (size_t) y * width + x;
+            if(precision == SINGLE)
+                ((float*) rhs)[i] = (float) (scale * f[i]);
+            else
+                ((double*) rhs)[i] = scale * f[i];
+        }
+    }
+
+    return rhs;
+}
+
+#endif // SOURCE_H
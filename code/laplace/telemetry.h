@@ -0,0 +1,203 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+/* Convergence telemetry of the iterative solvers: every `period` iterations, a record is written to a CSV file (or a JSON lines file, if its name ends with `.json`), with
+ * - the iteration and the error (maximal change),
+ * - the elapsed time (since the start of the solver),
+ * - the throughput since the previous record, in lattice updates per second and (estimated) bytes per second,
+ * - the convergence factor (per iteration), fitted on the last `TELEMETRY_WINDOW` records (`error ~ C * factor^iteration`),
+ * - the estimated time to reach the threshold (ETA), using that factor and the recent time per iteration.
+ * A summary is printed at the end.
+ * Each record can also be passed to a callback (see `laplace.h`), in which case the file is optional.
+ * A record costs a clock reading, a fit over the window and a (buffered) write, so that the overhead is negligible as soon as the grid is not tiny.
+ *
+ * Requires `../timer.h`.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define TELEMETRY_WINDOW 64
+
+typedef struct Telemetry_ {
+    FILE* output; // (NULL if there is no file)
+    int json;
+    int period; // number of iterations between two records
+
+    /* called on each record, if not NULL */
+    void (*callback)(void* data, int iter, double error);
+    void* data;
+
+    /* set by `telemetry_start()` */
+    double updates; // lattice updates per iteration
+    double bytes; // bytes moved per lattice update (estimated)
+    double threshold;
+    struct timespec start;
+
+    /* last record */
+    int next; // iteration of the next record
+    int iter;
+    double time;
+
+    /* last records, as (iteration, log(error)) */
+    int count;
+    double window[TELEMETRY_WINDOW][2];
+} Telemetry;
+
+/* Create a telemetry stream to the file at `path` (or without a file, if NULL), with a record every `period` iterations.
+ * Returns NULL on error.
+ */
+Telemetry* telemetry_new(const char* path, int period) {
+    Telemetry* telemetry = malloc(sizeof(Telemetry));
+    if(telemetry == NULL)
+        return NULL;
+
+    telemetry->output = NULL;
+    telemetry->json = 0;
+    telemetry->period = (period > 0) ? period : 1;
+    telemetry->callback = NULL;
+    telemetry->data = NULL;
+    if(path == NULL)
+        return telemetry;
+
+    telemetry->output = fopen(path, "w");
+    if(telemetry->output == NULL) {
+        free(telemetry);
+        return NULL;
+    }
+
+    size_t length = strlen(path);
+    telemetry->json = length > 5 && strcmp(path + length - 5, ".json") == 0;
+
+    if(!telemetry->json)
+        fprintf(telemetry->output, "iteration,error,time,updates_per_second,bytes_per_second,factor,eta\n");
+
+    return telemetry;
+}
+
+/* Start recording a solver, on a `width x height` grid, which moves (about) `bytes` bytes per lattice update, until the error is below `threshold`.
+ * Nothing happens if `telemetry` is NULL (in all the functions).
+ */
+void telemetry_start(Telemetry* telemetry, unsigned int width, unsigned int height, double bytes, double threshold) {
+    if(telemetry != NULL) {
+        telemetry->updates = (double) (width - 2) * (height - 2);
+        telemetry->bytes = bytes;
+        telemetry->threshold = threshold;
+        telemetry->next = 1;
+        telemetry->iter = 0;
+        telemetry->time = .0;
+        telemetry->count = 0;
+        timer_start(&telemetry->start);
+    }
+}
+
+/* Get the convergence factor per iteration (least squares fit of `log(error)` over the window), or NaN if there are not enough records.
+ */
+double telemetry_factor(Telemetry* telemetry) {
+    int n = (telemetry->count < TELEMETRY_WINDOW) ? telemetry->count : TELEMETRY_WINDOW;
+    if(n < 2)
+        return NAN;
+
+    /* (centered, to avoid the cancellation on large iterations) */
+    double mean_x = .0, mean_y = .0, sxx = .0, sxy = .0;
+    for(int i=0; i < n; i++) {
+        mean_x += telemetry->window[i][0] / n;
+        mean_y += telemetry->window[i][1] / n;
+    }
+
+    for(int i=0; i < n; i++) {
+        double dx = telemetry->window[i][0] - mean_x;
+        sxx += dx * dx;
+        sxy += dx * (telemetry->window[i][1] - mean_y);
+    }
+
+    return (sxx > 0) ? exp(sxy / sxx) : NAN;
+}
+
+/* Get the estimated time (in seconds) to reach the threshold from `error`, or NaN if the error does not decrease.
+ */
+double telemetry_eta(Telemetry* telemetry, double error, double time_per_iteration) {
+    double factor = telemetry_factor(telemetry);
+    if(error < telemetry->threshold)
+        return .0;
+    if(!(factor < 1) || factor <= 0)
+        return NAN;
+
+    return log(telemetry->threshold / error) / log(factor) * time_per_iteration;
+}
+
+/* Record the error after `iter` iterations (if a record is due).
+ */
+void telemetry_update(Telemetry* telemetry, int iter, double error) {
+    if(telemetry == NULL || iter < telemetry->next)
+        return;
+
+    telemetry->next = (iter / telemetry->period + 1) * telemetry->period;
+
+    double time = timer_stop(&telemetry->start), elapsed = time - telemetry->time;
+    double updates_per_second = (elapsed > 0) ? (iter - telemetry->iter) * telemetry->updates / elapsed : .0;
+    double time_per_iteration = (iter > telemetry->iter) ? elapsed / (iter - telemetry->iter) : .0;
+
+    if(error > 0) {
+        telemetry->window[telemetry->count % TELEMETRY_WINDOW][0] = iter;
+        telemetry->window[telemetry->count % TELEMETRY_WINDOW][1] = log(error);
+        telemetry->count++;
+    }
+
+    double factor = telemetry_factor(telemetry), eta = telemetry_eta(telemetry, error, time_per_iteration);
+
+    if(telemetry->callback != NULL)
+        telemetry->callback(telemetry->data, iter, error);
+
+    if(telemetry->output != NULL && telemetry->json) {
+        char factor_value[32] = "null", eta_value[32] = "null"; // (no NaN in JSON)
+        if(!isnan(factor))
+            snprintf(factor_value, sizeof(factor_value), "%.9g", factor);
+        if(!isnan(eta))
+            snprintf(eta_value, sizeof(eta_value), "%g", eta);
+
+        fprintf(telemetry->output, "{\"iteration\": %d, \"error\": %g, \"time\": %g, \"updates_per_second\": %g, \"bytes_per_second\": %g, \"factor\": %s, \"eta\": %s}\n",
+                iter, error, time, updates_per_second, updates_per_second * telemetry->bytes, factor_value, eta_value);
+    } else if(telemetry->output != NULL)
+        fprintf(telemetry->output, "%d,%g,%g,%g,%g,%.9g,%g\n", iter, error, time, updates_per_second, updates_per_second * telemetry->bytes, factor, eta);
+
+    telemetry->iter = iter;
+    telemetry->time = time;
+}
+
+/* Print a summary of the solver, which stopped after `iter` iterations with an error of `error`.
+ */
+void telemetry_summary(Telemetry* telemetry, int iter, double error) {
+    if(telemetry == NULL || telemetry->output == NULL || iter < 1)
+        return;
+
+    double time = timer_stop(&telemetry->start), updates_per_second = iter * telemetry->updates / time;
+    double factor = telemetry_factor(telemetry);
+
+    fflush(telemetry->output);
+    printf("telemetry: %.3f us/iteration, %.3f Gupdates/s, %.3f GB/s (estimated)\n", time / iter * 1e6, updates_per_second * 1e-9, updates_per_second * telemetry->bytes * 1e-9);
+
+    if(isnan(factor))
+        return;
+
+    printf("telemetry: convergence factor of %.9f per iteration", factor);
+    if(error >= telemetry->threshold && factor < 1) {
+        double remaining = log(telemetry->threshold / error) / log(factor);
+        printf(", the threshold would need %.0f more iterations (%.3f secs)", remaining, remaining * time / iter);
+    }
+    printf("\n");
+}
+
+/* Close the stream, and free the telemetry.
+ */
+void telemetry_delete(Telemetry* telemetry) {
+    if(telemetry != NULL) {
+        if(telemetry->output != NULL)
+            fclose(telemetry->output);
+        free(telemetry);
+    }
+}
+
+#endif // TELEMETRY_H
@@ -35,8 +35,8 @@ int main(int argc, char* argv[]) {
     }
     
     /* allocate */
-    float* svecx = malloc(vec_size * sizeof(float));
-    float* svecy = malloc(vec_size * sizeof(float));
+    float* svecx = arena_alloc(vec_size * sizeof(float));
+    float* svecy = arena_alloc(vec_size * sizeof(float));
     
     if (svecx == NULL || svecy == NULL) {
         printf("error while allocating svecx and svecy\n");
@@ -63,12 +63,12 @@ int main(int argc, char* argv[]) {
     }
 
     /* free */
-    free(svecx);
-    free(svecy);
+    arena_free(svecx);
+    arena_free(svecy);
 
     /* allocate */
-    double* dvecx = malloc(vec_size * sizeof(double));
-    double* dvecy = malloc(vec_size * sizeof(double));
+    double* dvecx = arena_alloc(vec_size * sizeof(double));
+    double* dvecy = arena_alloc(vec_size * sizeof(double));
 
     if (dvecx == NULL || dvecy == NULL) {
         printf("error while allocating dvecx and dvecy\n");
@@ -95,8 +95,9 @@ int main(int argc, char* argv[]) {
     }
 
     /* free */
-    free(dvecx);
-    free(dvecy);
+    arena_free(dvecx);
+    arena_free(dvecy);
+    arena_release();
 
     output_results(time_saxpy / ntimes, time_daxpy / ntimes);
     return EXIT_SUCCESS;
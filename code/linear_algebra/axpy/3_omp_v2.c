@@ -1,4 +1,4 @@
-/* Second OMP version of *axpy, with first touch
+/* Second OMP version of *axpy, with first touch (the kernels are in `../blas1.h`)
  * Compile with `gcc -o axpy 3_omp_v2.c -O1 -fopenmp -lm`
  * Don't forget `export OMP_NUM_THREADS=xx` to run.
  */
@@ -8,26 +8,9 @@
 #include <omp.h>
 #include "../common.h"
 #include "output.h"
+#include "../blas1.h"
 #include <math.h>
 
-void saxpy(int n, float alpha, float* restrict x, float* restrict y) {
-    if (n > 0 && alpha != 0.f) {
-        #pragma omp parallel for simd
-        for(int i=0; i < n; i++) {
-            y[i] += alpha * x[i];
-        }
-    }
-}
-
-void daxpy(int n, double alpha, double* restrict x, double* restrict y) {
-    if (n > 0 && alpha != 0.f) {
-        #pragma omp parallel for simd
-        for(int i=0; i < n; i++) {
-            y[i] += alpha * x[i];
-        }
-    }
-}
-
 int main(int argc, char* argv[]) {
     int vec_size = -1, ntimes = -1, i=0;
     double time_saxpy = .0f, time_daxpy = .0f;
@@ -39,8 +22,8 @@ int main(int argc, char* argv[]) {
     }
     
     /* allocate */
-    float* svecx = malloc(vec_size * sizeof(float));
-    float* svecy = malloc(vec_size * sizeof(float));
+    float* svecx = arena_alloc(vec_size * sizeof(float));
+    float* svecy = arena_alloc(vec_size * sizeof(float));
     
     if (svecx == NULL || svecy == NULL) {
         printf("error while allocating svecx and svecy\n");
@@ -69,12 +52,12 @@ int main(int argc, char* argv[]) {
     }
 
     /* free */
-    free(svecx);
-    free(svecy);
+    arena_free(svecx);
+    arena_free(svecy);
 
     /* allocate */
-    double* dvecx = malloc(vec_size * sizeof(double));
-    double* dvecy = malloc(vec_size * sizeof(double));
+    double* dvecx = arena_alloc(vec_size * sizeof(double));
+    double* dvecy = arena_alloc(vec_size * sizeof(double));
 
     if (dvecx == NULL || dvecy == NULL) {
         printf("error while allocating dvecx and dvecy\n");
@@ -103,8 +86,9 @@ int main(int argc, char* argv[]) {
     }
 
     /* free */
-    free(dvecx);
-    free(dvecy);
+    arena_free(dvecx);
+    arena_free(dvecy);
+    arena_release();
 
     output_results(time_saxpy / ntimes, time_daxpy / ntimes);
     return EXIT_SUCCESS;
@@ -1,4 +1,4 @@
-/* MPI version of axpy
+/* MPI version of axpy (the kernels are in `../blas1.h`)
  * Compile with `mpicc -o axpy 4_mpi.c -O1`
  * Run with `mpirun -np 4 ./axpy`
  */
@@ -9,25 +9,10 @@
 #include <math.h>
 #include "../common.h"
 #include "output.h"
+#include "../blas1.h"
 
 #define SCATT_ROOT 0
 
-void saxpy(int n, float alpha, float* restrict x, float* restrict y) {
-    if (n > 0 && alpha != 0.f) {
-        for(int i=0; i < n; i++) {
-            y[i] += alpha * x[i];
-        }
-    }
-}
-
-void daxpy(int n, double alpha, double* restrict x, double* restrict y) {
-    if (n > 0 && alpha != 0.f) {
-        for(int i=0; i < n; i++) {
-            y[i] += alpha * x[i];
-        }
-    }
-}
-
 int main(int argc, char* argv[]) {
     int vec_size = -1, ntimes = -1, i=0, rank, comm_size, partial_vec_size;
     double time_saxpy = .0f, time_daxpy = .0f;
@@ -48,8 +33,8 @@ int main(int argc, char* argv[]) {
 
     if(rank == SCATT_ROOT) {
         /* allocate */
-        svecx = malloc(vec_size * sizeof(float));
-        svecy = malloc(vec_size * sizeof(float));
+        svecx = arena_alloc(vec_size * sizeof(float));
+        svecy = arena_alloc(vec_size * sizeof(float));
         
         if (svecx == NULL || svecy == NULL) {
             printf("error while allocating svecx and svecy\n");
@@ -63,8 +48,8 @@ int main(int argc, char* argv[]) {
         }
     }
 
-    partial_svecx = malloc(sizeof(float) * partial_vec_size);
-    partial_svecy = malloc(sizeof(float) * partial_vec_size);
+    partial_svecx = arena_alloc(sizeof(float) * partial_vec_size);
+    partial_svecy = arena_alloc(sizeof(float) * partial_vec_size);
 
     if(partial_svecx == NULL || partial_svecy == NULL) {
         printf("error while allocating partial_svecx and partial_svecy\n");
@@ -87,8 +72,8 @@ int main(int argc, char* argv[]) {
             time_saxpy += timer_stop(&timer);
     }
     
-    free(partial_svecx);
-    free(partial_svecy);
+    arena_free(partial_svecx);
+    arena_free(partial_svecy);
 
     if(rank == SCATT_ROOT) {
         /* check */
@@ -98,14 +83,14 @@ int main(int argc, char* argv[]) {
         }
 
         /* free */
-        free(svecx);
-        free(svecy);
+        arena_free(svecx);
+        arena_free(svecy);
     }
 
     if(rank == SCATT_ROOT) {
         /* allocate */
-        dvecx = malloc(vec_size * sizeof(double));
-        dvecy = malloc(vec_size * sizeof(double));
+        dvecx = arena_alloc(vec_size * sizeof(double));
+        dvecy = arena_alloc(vec_size * sizeof(double));
 
         if (dvecx == NULL || dvecy == NULL) {
             printf("error while allocating dvecx and dvecy\n");
@@ -119,8 +104,8 @@ int main(int argc, char* argv[]) {
         }
     }
 
-    partial_dvecx = malloc(sizeof(double) * partial_vec_size);
-    partial_dvecy = malloc(sizeof(double) * partial_vec_size);
+    partial_dvecx = arena_alloc(sizeof(double) * partial_vec_size);
+    partial_dvecy = arena_alloc(sizeof(double) * partial_vec_size);
 
     if(partial_dvecx == NULL || partial_dvecy == NULL) {
         printf("error while allocating partial_dvecx and partial_dvecy\n");
@@ -143,8 +128,8 @@ int main(int argc, char* argv[]) {
             time_daxpy += timer_stop(&timer);
     }
     
-    free(partial_dvecx);
-    free(partial_dvecy);
+    arena_free(partial_dvecx);
+    arena_free(partial_dvecy);
     
     if(rank == SCATT_ROOT) {
         /* check */
@@ -154,13 +139,14 @@ int main(int argc, char* argv[]) {
         }
 
         /* free */
-        free(dvecx);
-        free(dvecy);
+        arena_free(dvecx);
+        arena_free(dvecy);
 
         /* output */
         output_results(time_saxpy / ntimes, time_daxpy / ntimes);
     }
 
+    arena_release();
     MPI_Finalize();
     return EXIT_SUCCESS;
 }
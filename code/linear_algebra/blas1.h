@@ -0,0 +1,89 @@
+#ifndef INCLUDE_BLAS1_H
+#define INCLUDE_BLAS1_H
+
+/* Level 1 BLAS kernels (`*axpy`, `*dot` and `*scal`), in a simplified form (no `incx` and `incy`).
+ * They are parallelized with OMP (with first touch in mind, i.e., with the default static schedule), so that they are serial if compiled without `-fopenmp` (as in the MPI versions, where they work on the local part of the vectors).
+ */
+
+/* Compute y:= alpha * x + y, where alpha is a scalar, and x and y are n-vectors.
+ * n: the number of element in the vector. Must be >= 1, otherwise nothing happen.
+ * alpha: the scalar. If alpha is 0, nothing happen.
+ * x: array of size n (remains untouched).
+ * y: array of size n.
+ */
+void saxpy(int n, float alpha, float* restrict x, float* restrict y) {
+    if (n > 0 && alpha != 0.f) {
+        #pragma omp parallel for simd
+        for(int i=0; i < n; i++) {
+            y[i] += alpha * x[i];
+        }
+    }
+}
+
+void daxpy(int n, double alpha, double* restrict x, double* restrict y) {
+    if (n > 0 && alpha != 0.f) {
+        #pragma omp parallel for simd
+        for(int i=0; i < n; i++) {
+            y[i] += alpha * x[i];
+        }
+    }
+}
+
+/* Compute the dot product between x and y, where x and y are n-vectors.
+ * Uses a Kahan sum to mitigate the numerical error.
+ * n: the number of element in the vector. Must be >= 1, otherwise zero is returned.
+ * x: array of size n (remains untouched).
+ * y: array of size n (remains untouched).
+ */
+float sdot(int n, float* restrict x, float* restrict y) {
+    float sum = .0f, c = .0f, q, r;
+    if (n > 0) {
+        #pragma omp parallel for reduction(+:sum) firstprivate(c) private(q, r)
+        for(int i=0; i < n; i++) {
+            q = y[i] * x[i] - c;
+            r = sum + q;
+            c = (r - sum) - q;
+            sum = r;
+        }
+    }
+    return sum;
+}
+
+double ddot(int n, double* restrict x, double* restrict y) {
+    double sum = .0f, c = .0f, q, r;
+    if (n > 0) {
+        #pragma omp parallel for reduction(+:sum) firstprivate(c) private(q, r)
+        for(int i=0; i < n; i++) {
+            q = y[i] * x[i] - c;
+            r = sum + q;
+            c = (r - sum) - q;
+            sum = r;
+        }
+    }
+    return sum;
+}
+
+/* Compute x:= alpha * x, where alpha is a scalar, and x is a n-vector.
+ * n: the number of element in the vector. Must be >= 1, otherwise nothing happen.
+ * alpha: the scalar.
+ * x: array of size n.
+ */
+void sscal(int n, float alpha, float* x) {
+    if (n > 0) {
+        #pragma omp parallel for simd
+        for(int i=0; i < n; i++) {
+            x[i] *= alpha;
+        }
+    }
+}
+
+void dscal(int n, double alpha, double* x) {
+    if (n > 0) {
+        #pragma omp parallel for simd
+        for(int i=0; i < n; i++) {
+            x[i] *= alpha;
+        }
+    }
+}
+
+#endif // INCLUDE_BLAS1_H
@@ -4,6 +4,7 @@
 #include <string.h>
 
 #include "../timer.h"
+#include "../arena.h"
 
 #define VECX 2.0
 #define VECY 3.0
@@ -13,9 +14,11 @@
 #define DEFAULT_NTIMES 10
 
 /* Get the program argument (if provided) from the command line options (`-n xx -N yy`) or fallback to defaults.
+ * `-a xx` selects the allocator of the vectors (see `../arena.h`).
  * Returns 0 if the number was read, or if no option is provided,
  * Returns -1 if there is no number after the option,
- * Returns -2 if a number is <= 0.
+ * Returns -2 if a number is <= 0,
+ * Returns -3 if the allocator does not exist.
  */
 int get_arguments(int argc, char* argv[], int* vec_size, int* ntimes) {
     *vec_size = DEFAULT_VEC_SIZE;
@@ -39,6 +42,12 @@ int get_arguments(int argc, char* argv[], int* vec_size, int* ntimes) {
                     if(*ntimes < 1)
                         return -2;
                 }
+            } else if(strcmp(argv[i], "-a") == 0) {
+                if((i+1) == argc) { // `-a`, but no allocator provided :(
+                    return -1;
+                } else if(arena_select(argv[i + 1]) == NULL) {
+                    return -3;
+                }
             }
         }
     }
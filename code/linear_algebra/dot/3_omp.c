@@ -1,5 +1,5 @@
-/* OMP version of *dot (with the reduction clause!!)
- * Compile with `gcc -o dot 3_omp_v1.c -O1 -lm -fopenmp`
+/* OMP version of *dot, with the reduction clause!! The kernels are in `../blas1.h`.
+ * Compile with `gcc -o dot 3_omp.c -O1 -lm -fopenmp`
  * Don't forget `export OMP_NUM_THREADS=xx` to run.
  */
 
@@ -7,36 +7,9 @@
 #include <stdlib.h>
 #include "../common.h"
 #include "output.h"
+#include "../blas1.h"
 #include <math.h>
 
-float sdot(int n, float* restrict x, float* restrict y) {
-    float sum = .0f, c = .0f, q, r;
-    if (n > 0) {
-        #pragma omp parallel for reduction(+:sum) firstprivate(c) private(q, r)
-        for(int i=0; i < n; i++) {
-            q = y[i] * x[i] - c;
-            r = sum + q;
-            c = (r - sum) - q;
-            sum = r;
-        }
-    }
-    return sum;
-}
-
-double ddot(int n, double* restrict x, double* restrict y) {
-    double sum = .0f, c = .0f, q, r;
-    if (n > 0) {
-        #pragma omp parallel for reduction(+:sum) firstprivate(c) private(q, r)
-        for(int i=0; i < n; i++) {
-            q = y[i] * x[i] - c;
-            r = sum + q;
-            c = (r - sum) - q;
-            sum = r;
-        }
-    }
-    return sum;
-}
-
 int main(int argc, char* argv[]) {
     int vec_size = -1, ntimes = -1, i;
     float result_sdot;
@@ -49,8 +22,8 @@ int main(int argc, char* argv[]) {
     }
     
     /* allocate */
-    float* svecx = malloc(vec_size * sizeof(float));
-    float* svecy = malloc(vec_size * sizeof(float));
+    float* svecx = arena_alloc(vec_size * sizeof(float));
+    float* svecy = arena_alloc(vec_size * sizeof(float));
     
     if (svecx == NULL || svecy == NULL) {
         printf("error while allocating svecx and svecy\n");
@@ -75,12 +48,12 @@ int main(int argc, char* argv[]) {
         printf("sdot: the value is incorrect!\n");
 
     /* free */
-    free(svecx);
-    free(svecy);
+    arena_free(svecx);
+    arena_free(svecy);
 
     /* allocate */
-    double* dvecx = malloc(vec_size * sizeof(double));
-    double* dvecy = malloc(vec_size * sizeof(double));
+    double* dvecx = arena_alloc(vec_size * sizeof(double));
+    double* dvecy = arena_alloc(vec_size * sizeof(double));
 
     if (dvecx == NULL || dvecy == NULL) {
         printf("error while allocating dvecx and dvecy\n");
@@ -105,8 +78,9 @@ int main(int argc, char* argv[]) {
         printf("ddot: the value is incorrect!\n");
 
     /* free */
-    free(dvecx);
-    free(dvecy);
+    arena_free(dvecx);
+    arena_free(dvecy);
+    arena_release();
 
     output_results(time_sdot / ntimes, time_ddot / ntimes);
     return EXIT_SUCCESS;
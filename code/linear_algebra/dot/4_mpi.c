@@ -1,4 +1,4 @@
-/* MPI version of *dot
+/* MPI version of *dot (the kernels are in `../blas1.h`)
  * Compile with `mpicc -o dot 4_mpi.c -O1 -lm`
  * Run it with `mpirun -np 4 ./dot`
  */
@@ -7,37 +7,12 @@
 #include <stdlib.h>
 #include "../common.h"
 #include "output.h"
+#include "../blas1.h"
 #include <math.h>
 #include <mpi.h>
 
 #define SCATT_ROOT 0
 
-float sdot(int n, float* x, float* y) {
-    float sum = .0f, c = .0f, q, r;
-    if (n > 0) {
-        for(int i=0; i < n; i++) {
-            q = y[i] * x[i] - c;
-            r = sum + q;
-            c = (r - sum) - q;
-            sum = r;
-        }
-    }
-    return sum;
-}
-
-double ddot(int n, double* x, double* y) {
-    double sum = .0f, c = .0f, q, r;
-    if (n > 0) {
-        for(int i=0; i < n; i++) {
-            q = y[i] * x[i] - c;
-            r = sum + q;
-            c = (r - sum) - q;
-            sum = r;
-        }
-    }
-    return sum;
-}
-
 int main(int argc, char* argv[]) {
     int vec_size = -1, ntimes = -1, i, rank, comm_size, partial_vec_size;
     float result_sdot, partial_result_sdot;
@@ -59,8 +34,8 @@ int main(int argc, char* argv[]) {
     
     if(rank == SCATT_ROOT) {
         /* allocate */
-        svecx = malloc(vec_size * sizeof(float));
-        svecy = malloc(vec_size * sizeof(float));
+        svecx = arena_alloc(vec_size * sizeof(float));
+        svecy = arena_alloc(vec_size * sizeof(float));
         
         if (svecx == NULL || svecy == NULL) {
             printf("error while allocating svecx and svecy\n");
@@ -74,8 +49,8 @@ int main(int argc, char* argv[]) {
         }
     }
     
-    partial_svecx = malloc(sizeof(float) * partial_vec_size);
-    partial_svecy = malloc(sizeof(float) * partial_vec_size);
+    partial_svecx = arena_alloc(sizeof(float) * partial_vec_size);
+    partial_svecy = arena_alloc(sizeof(float) * partial_vec_size);
 
     if(partial_svecx == NULL || partial_svecy == NULL) {
         printf("error while allocating partial_svecx and partial_svecy\n");
@@ -98,20 +73,20 @@ int main(int argc, char* argv[]) {
             time_sdot += timer_stop(&timer);
     }
 
-    free(partial_svecx);
-    free(partial_svecy);
+    arena_free(partial_svecx);
+    arena_free(partial_svecy);
 
     if(rank == SCATT_ROOT) {
         if (fabs(result_sdot - vec_size * VECX * VECY) > __FLT_EPSILON__)
             printf("sdot: the value is incorrect!\n");
 
         /* free */
-        free(svecx);
-        free(svecy);
+        arena_free(svecx);
+        arena_free(svecy);
 
         /* allocate */
-        dvecx = malloc(vec_size * sizeof(double));
-        dvecy = malloc(vec_size * sizeof(double));
+        dvecx = arena_alloc(vec_size * sizeof(double));
+        dvecy = arena_alloc(vec_size * sizeof(double));
 
         if (dvecx == NULL || dvecy == NULL) {
             printf("error while allocating dvecx and dvecy\n");
@@ -126,8 +101,8 @@ int main(int argc, char* argv[]) {
 
     }
     
-    partial_dvecx = malloc(sizeof(double) * partial_vec_size);
-    partial_dvecy = malloc(sizeof(double) * partial_vec_size);
+    partial_dvecx = arena_alloc(sizeof(double) * partial_vec_size);
+    partial_dvecy = arena_alloc(sizeof(double) * partial_vec_size);
 
     if(partial_dvecx == NULL || partial_dvecy == NULL) {
         printf("error while allocating partial_dvecx and partial_dvecy\n");
@@ -150,20 +125,21 @@ int main(int argc, char* argv[]) {
             time_ddot += timer_stop(&timer);
     }
 
-    free(partial_dvecx);
-    free(partial_dvecy);
+    arena_free(partial_dvecx);
+    arena_free(partial_dvecy);
 
     if(rank == SCATT_ROOT) {
         if (fabs(result_ddot - vec_size * VECX * VECY) > __DBL_EPSILON__)
             printf("ddot: the value is incorrect!\n");
 
         /* free */
-        free(dvecx);
-        free(dvecy);
+        arena_free(dvecx);
+        arena_free(dvecy);
 
         output_results(time_sdot / ntimes, time_ddot / ntimes);
     }
 
+    arena_release();
     MPI_Finalize();
     return EXIT_SUCCESS;
 }